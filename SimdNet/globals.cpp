@@ -131,3 +131,14 @@ bool hide_cursor ( ) noexcept {
     set_mode_unicode ( );
     return SetConsoleCursorInfo ( hOut, &info );
 }
+
+void * allocate_executable ( std::size_t size_ ) noexcept {
+    return VirtualAlloc ( nullptr, size_, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+}
+
+bool protect_executable ( void * p_, std::size_t size_ ) noexcept {
+    DWORD old_protect;
+    return VirtualProtect ( p_, size_, PAGE_EXECUTE_READ, &old_protect ) and FlushInstructionCache ( GetCurrentProcess ( ), p_, size_ );
+}
+
+void free_executable ( void * p_, std::size_t ) noexcept { VirtualFree ( p_, 0, MEM_RELEASE ); }
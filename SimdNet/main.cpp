@@ -63,6 +63,15 @@ void printChessPiecesUnicode ( ) {
 int main ( ) {
 
     Population<1'024 * 9, 39, 17, 5, 4> p;
+    // Population<1'024 * 9, 39, 17, 5, 4, activation::bipolar, simd::fp16> p; // Half precision genomes.
+
+    // p.benchmark_feed_forward ( );
+    // p.benchmark_activation ( );
+    // p.benchmark_quantization ( );
+    // p.export_champion ( );               // Writes z://tmp//champion.hpp.
+    // p.benchmark_export<champion> ( );    // With champion.hpp included.
+    // p.evaluation ( Evaluation::interleaved );
+    // p.quantization ( Quantization::int16 );
 
     p.run ( );
 
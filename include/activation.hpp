@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+
+#include "simd.hpp"
+
+// The activation functions (policies) of the neurons. Each one applies to a single pre-activation
+// (scalar) and, in place, to a vector of pre-activations at once (vector), the latter is what the
+// batched kernels use. The slope alpha is part of the policy.
+namespace activation {
+
+SIMD_KERNELS_BEGIN
+
+// The bipolar sigmoid, 2 / ( 1 + exp ( -2 * alpha * x ) ) - 1 (= tanh ( alpha * x )), exact. There's
+// no vector exp, so a vector is done lane by lane.
+struct bipolar {
+
+    static constexpr float alpha = 0.25f;
+
+    [[nodiscard]] static float scalar ( float net_ ) noexcept {
+        net_ *= alpha;
+        return 2.0f / ( 1.0f + std::exp ( -2.0f * net_ ) ) - 1.0f;
+    }
+
+    template<typename Isa>
+    SIMD_INLINE static void vector ( typename Isa::vec & net_ ) noexcept {
+        alignas ( 64 ) float v[ Isa::width ];
+        Isa::store ( v, net_ );
+        for ( float & f : v )
+            f = scalar ( f );
+        net_ = Isa::load ( v );
+    }
+};
+
+// The bipolar sigmoid, tanh ( alpha * x ), by its [7/6] Pade approximant, with the argument clamped
+// to [ -4.78, 4.78 ] (where the approximant is closest to tanh). The maximum absolute error is less
+// than 7.2e-5 over the whole real line.
+struct bipolar_rational {
+
+    static constexpr float alpha = 0.25f;
+    static constexpr float clamp = 4.78f;
+
+    [[nodiscard]] static float scalar ( float net_ ) noexcept {
+        vector<simd::scalar> ( net_ );
+        return net_;
+    }
+
+    template<typename Isa>
+    SIMD_INLINE static void vector ( typename Isa::vec & net_ ) noexcept {
+        using vec    = typename Isa::vec;
+        vec const x  = Isa::min ( Isa::max ( Isa::mul ( net_, Isa::broadcast ( alpha ) ), Isa::broadcast ( -clamp ) ),
+                                  Isa::broadcast ( clamp ) );
+        vec const x2 = Isa::mul ( x, x );
+        vec p        = Isa::add ( x2, Isa::broadcast ( 378.0f ) );
+        p            = Isa::fmadd ( p, x2, Isa::broadcast ( 17'325.0f ) );
+        p            = Isa::fmadd ( p, x2, Isa::broadcast ( 135'135.0f ) );
+        vec q        = Isa::fmadd ( x2, Isa::broadcast ( 28.0f ), Isa::broadcast ( 3'150.0f ) );
+        q            = Isa::fmadd ( q, x2, Isa::broadcast ( 62'370.0f ) );
+        q            = Isa::fmadd ( q, x2, Isa::broadcast ( 135'135.0f ) );
+        net_         = Isa::div ( Isa::mul ( x, p ), q );
+    }
+};
+
+// The elliot sigmoid, alpha * x / ( 1 + | alpha * x | ), bipolar as well, but with much longer tails.
+struct elliotsig {
+
+    static constexpr float alpha = 0.25f;
+
+    [[nodiscard]] static float scalar ( float net_ ) noexcept {
+        vector<simd::scalar> ( net_ );
+        return net_;
+    }
+
+    template<typename Isa>
+    SIMD_INLINE static void vector ( typename Isa::vec & net_ ) noexcept {
+        typename Isa::vec const x = Isa::mul ( net_, Isa::broadcast ( alpha ) );
+        net_                      = Isa::div ( x, Isa::add ( Isa::broadcast ( 1.0f ), Isa::abs ( x ) ) );
+    }
+};
+
+// The hard-clipped bipolar sigmoid, alpha * x clamped to [ -1, 1 ].
+struct bipolar_clipped {
+
+    static constexpr float alpha = 0.25f;
+
+    [[nodiscard]] static float scalar ( float net_ ) noexcept {
+        vector<simd::scalar> ( net_ );
+        return net_;
+    }
+
+    template<typename Isa>
+    SIMD_INLINE static void vector ( typename Isa::vec & net_ ) noexcept {
+        net_ = Isa::min ( Isa::max ( Isa::mul ( net_, Isa::broadcast ( alpha ) ), Isa::broadcast ( -1.0f ) ),
+                          Isa::broadcast ( 1.0f ) );
+    }
+};
+
+[[nodiscard]] inline wchar_t const * name ( bipolar ) noexcept { return L"bipolar"; }
+[[nodiscard]] inline wchar_t const * name ( bipolar_rational ) noexcept { return L"bipolar_rational"; }
+[[nodiscard]] inline wchar_t const * name ( elliotsig ) noexcept { return L"elliotsig"; }
+[[nodiscard]] inline wchar_t const * name ( bipolar_clipped ) noexcept { return L"bipolar_clipped"; }
+
+SIMD_KERNELS_END
+
+} // namespace activation
@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <array>
+#include <atomic>
+
+// Detects a repeated state of an episode, the states are (Zobrist) keys, kept in a direct-mapped
+// table. A state can only repeat while the snake doesn't eat, so an entry is only valid in the epoch
+// it was made in, and a new epoch starts whenever the snake eats (or a new episode starts), nothing
+// gets cleared. An entry that is overwritten only delays the detection (by a lap of the cycle). The
+// totals of the steps saved (by ending the episodes on a cycle) are kept over all detectors.
+template<int Bits = 10>
+class CycleDetector {
+
+    public:
+    static constexpr int Size = 1 << Bits;
+
+    // The key of i_, (the finalizer of) splitmix64.
+    [[nodiscard]] static constexpr std::uint64_t zobrist ( std::uint64_t i_ ) noexcept {
+        i_ += 0x9E37'79B9'7F4A'7C15ull;
+        i_ = ( i_ ^ ( i_ >> 30 ) ) * 0xBF58'476D'1CE4'E5B9ull;
+        i_ = ( i_ ^ ( i_ >> 27 ) ) * 0x94D0'49BB'1331'11EBull;
+        return i_ ^ ( i_ >> 31 );
+    }
+
+    // Returns whether key_ was seen before (in this epoch), and records it.
+    [[nodiscard]] bool repeated ( std::uint64_t const key_ ) noexcept {
+        Entry & e = m_entries[ static_cast<int> ( key_ >> ( 64 - Bits ) ) ];
+        if ( e.epoch == m_epoch and e.key == key_ )
+            return true;
+        e = { key_, m_epoch };
+        return false;
+    }
+
+    void next_epoch ( ) noexcept { ++m_epoch; }
+
+    // An episode ended on a cycle, num_steps_ steps before it would have.
+    static void add ( int const num_steps_ ) noexcept {
+        s_cycles.fetch_add ( 1, std::memory_order_relaxed );
+        s_steps.fetch_add ( num_steps_, std::memory_order_relaxed );
+    }
+
+    // The totals since the last reset.
+    [[nodiscard]] static std::int64_t cycles ( ) noexcept { return s_cycles.load ( std::memory_order_relaxed ); }
+    [[nodiscard]] static std::int64_t steps ( ) noexcept { return s_steps.load ( std::memory_order_relaxed ); }
+
+    static void reset ( ) noexcept {
+        s_cycles.store ( 0, std::memory_order_relaxed );
+        s_steps.store ( 0, std::memory_order_relaxed );
+    }
+
+    private:
+    struct Entry {
+        std::uint64_t key;
+        std::uint32_t epoch;
+    };
+
+    std::array<Entry, Size> m_entries{ }; // Epoch 0 is never current.
+    std::uint32_t m_epoch = 1;
+
+    static inline std::atomic<std::int64_t> s_cycles{ 0 }, s_steps{ 0 };
+};
@@ -0,0 +1,119 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <array>
+#include <atomic>
+
+// A direct-mapped cache of the decisions of a brain, keyed on its (quantized) observation, laid out
+// as by SnakeSpace::Encoder17: 12 distances (reciprocals of small integers, or zero), a one-hot
+// direction and the energy term 1 / ( 1 + energy ). The distances (as their integer, one byte) and the
+// direction are kept exactly, the energy term is rounded to a multiple of 1 / EnergyScale, so the
+// observations that only differ a little in the energy of the snake share an entry. An entry is only
+// valid in the epoch it was made in, invalidate starts a new epoch (call it whenever the brain changes,
+// nothing gets cleared). Made to be used one per thread, the counts of all of them add up to the totals.
+template<typename Decision, int Bits = 10>
+class DecisionCache {
+
+    public:
+    static constexpr int Size        = 1 << Bits;
+    static constexpr int EnergyScale = 256;
+
+    struct Key {
+        std::uint64_t lo, hi;
+
+        [[nodiscard]] bool operator== ( Key const & rhs_ ) const noexcept { return lo == rhs_.lo and hi == rhs_.hi; }
+    };
+
+    // The key of the observation o_ (17 floats).
+    [[nodiscard]] static Key key ( float const * const o_ ) noexcept {
+        auto distance = [ o_ ] ( int const i_ ) noexcept {
+            return static_cast<std::uint64_t> ( o_[ i_ ] > 0.0f ? static_cast<int> ( 1.0f / o_[ i_ ] + 0.5f ) & 0xFF : 0 );
+        };
+        Key k{ 0, 0 };
+        for ( int i = 0; i < 8; ++i )
+            k.lo |= distance ( i ) << ( 8 * i );
+        for ( int i = 8; i < 12; ++i )
+            k.hi |= distance ( i ) << ( 8 * ( i - 8 ) );
+        for ( int i = 12; i < 16; ++i )
+            k.hi |= static_cast<std::uint64_t> ( o_[ i ] != 0.0f ) << ( 32 + i - 12 );
+        int const energy = static_cast<int> ( o_[ 16 ] * EnergyScale + 0.5f );
+        k.hi |= static_cast<std::uint64_t> ( energy < 0xFF ? energy : 0xFF ) << 40;
+        return k;
+    }
+
+    // Returns whether the decision for key_ is cached (written to decision_).
+    [[nodiscard]] bool find ( Key const & key_, Decision & decision_ ) noexcept {
+        Entry const & e = m_entries[ slot ( key_ ) ];
+        ++m_lookups;
+        if ( e.epoch == m_epoch and e.key == key_ ) {
+            ++m_hits;
+            decision_ = e.decision;
+            return true;
+        }
+        return false;
+    }
+
+    void insert ( Key const & key_, Decision const decision_ ) noexcept {
+        m_entries[ slot ( key_ ) ] = { key_, m_epoch, decision_ };
+    }
+
+    // All entries become invalid, the counts of this cache are added to the totals.
+    void invalidate ( ) noexcept {
+        ++m_epoch;
+        s_hits.fetch_add ( m_hits, std::memory_order_relaxed );
+        s_lookups.fetch_add ( m_lookups, std::memory_order_relaxed );
+        m_hits = m_lookups = 0;
+    }
+
+    // The totals (of the invalidated caches) since the last reset.
+    [[nodiscard]] static std::int64_t hits ( ) noexcept { return s_hits.load ( std::memory_order_relaxed ); }
+    [[nodiscard]] static std::int64_t lookups ( ) noexcept { return s_lookups.load ( std::memory_order_relaxed ); }
+
+    static void reset ( ) noexcept {
+        s_hits.store ( 0, std::memory_order_relaxed );
+        s_lookups.store ( 0, std::memory_order_relaxed );
+    }
+
+    private:
+    struct Entry {
+        Key key;
+        std::uint32_t epoch;
+        Decision decision;
+    };
+
+    [[nodiscard]] static int slot ( Key const & key_ ) noexcept {
+        std::uint64_t const h = ( key_.lo * 0x9E37'79B9'7F4A'7C15ull ) ^ ( key_.hi * 0xC2B2'AE3D'27D4'EB4Full );
+        return static_cast<int> ( h >> ( 64 - Bits ) );
+    }
+
+    std::array<Entry, Size> m_entries{ }; // Epoch 0 is never current.
+    std::uint32_t m_epoch = 1;
+    std::int64_t m_hits = 0, m_lookups = 0;
+
+    static inline std::atomic<std::int64_t> s_hits{ 0 }, s_lookups{ 0 };
+};
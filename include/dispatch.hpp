@@ -0,0 +1,299 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+
+#if defined( _MSC_VER )
+#    include <intrin.h>
+#else
+#    include <cpuid.h>
+#endif
+
+#include "simd.hpp"
+
+// Runtime dispatch of the kernels. Every kernel is compiled for all instruction sets, the widest one
+// the cpu supports is picked once, at startup, from cpuid. The VNNI extensions only change the integer
+// dot product, only the kernels that use it (Vnni) get compiled for them, the others run the
+// instruction set extended.
+namespace simd {
+
+enum class InstructionSet : int { scalar, sse42, avx2, avx2_vnni, avx512, avx512_vnni };
+
+[[nodiscard]] inline wchar_t const * name ( InstructionSet const is_ ) noexcept {
+    switch ( is_ ) {
+        case InstructionSet::scalar: return L"scalar";
+        case InstructionSet::sse42: return L"sse4.2";
+        case InstructionSet::avx2: return L"avx2";
+        case InstructionSet::avx2_vnni: return L"avx2-vnni";
+        case InstructionSet::avx512: return L"avx512";
+        case InstructionSet::avx512_vnni: return L"avx512-vnni";
+    }
+    return L"";
+}
+
+namespace detail {
+
+inline void cpuid ( std::uint32_t ( &r_ )[ 4 ], std::uint32_t const leaf_, std::uint32_t const subleaf_ = 0u ) noexcept {
+#if defined( _MSC_VER )
+    int r[ 4 ];
+    __cpuidex ( r, static_cast<int> ( leaf_ ), static_cast<int> ( subleaf_ ) );
+    for ( int i = 0; i < 4; ++i )
+        r_[ i ] = static_cast<std::uint32_t> ( r[ i ] );
+#else
+    __cpuid_count ( leaf_, subleaf_, r_[ 0 ], r_[ 1 ], r_[ 2 ], r_[ 3 ] );
+#endif
+}
+
+// The register state the os saves on a context switch (XCR0).
+[[nodiscard]] inline std::uint64_t xgetbv ( ) noexcept {
+#if defined( _MSC_VER )
+    return _xgetbv ( 0 );
+#else
+    std::uint32_t lo, hi;
+    __asm__ ( "xgetbv" : "=a"( lo ), "=d"( hi ) : "c"( 0 ) );
+    return ( static_cast<std::uint64_t> ( hi ) << 32 ) | lo;
+#endif
+}
+
+[[nodiscard]] inline bool bit ( std::uint32_t const r_, int const b_ ) noexcept { return ( r_ >> b_ ) & 1u; }
+
+} // namespace detail
+
+// The widest instruction set supported by the cpu, and by the os (the avx registers are saved on a
+// context switch). Avx2 comes with fma and f16c, avx512 is avx512f and avx512bw, either one with VNNI
+// (AVX-VNNI, AVX512-VNNI) if the cpu has it.
+[[nodiscard]] inline InstructionSet detect ( ) noexcept {
+    std::uint32_t r[ 4 ];
+    detail::cpuid ( r, 0u );
+    std::uint32_t const max_leaf = r[ 0 ];
+    detail::cpuid ( r, 1u );
+    std::uint32_t const ecx = r[ 2 ];
+    if ( not detail::bit ( ecx, 20 ) )
+        return InstructionSet::scalar;
+    if ( max_leaf < 7u or not detail::bit ( ecx, 27 ) ) // No leaf 7, or no xgetbv.
+        return InstructionSet::sse42;
+    std::uint64_t const xcr0 = detail::xgetbv ( );
+    detail::cpuid ( r, 7u );
+    std::uint32_t const ebx = r[ 1 ], ecx7 = r[ 2 ], max_subleaf = r[ 0 ];
+    if ( ( xcr0 & 0x6u ) != 0x6u or not detail::bit ( ecx, 28 ) or not detail::bit ( ecx, 12 ) or not detail::bit ( ecx, 29 ) or
+         not detail::bit ( ebx, 5 ) )
+        return InstructionSet::sse42;
+    if ( ( xcr0 & 0xE6u ) != 0xE6u or not detail::bit ( ebx, 16 ) or not detail::bit ( ebx, 30 ) ) {
+        if ( max_subleaf < 1u )
+            return InstructionSet::avx2;
+        detail::cpuid ( r, 7u, 1u );
+        return detail::bit ( r[ 0 ], 4 ) ? InstructionSet::avx2_vnni : InstructionSet::avx2;
+    }
+    return detail::bit ( ecx7, 11 ) ? InstructionSet::avx512_vnni : InstructionSet::avx512;
+}
+
+// The instruction set the kernels run on, detected once.
+[[nodiscard]] inline InstructionSet instruction_set ( ) noexcept {
+    static InstructionSet const is = detect ( );
+    return is;
+}
+
+// The brand string of the cpu.
+[[nodiscard]] inline std::string cpu_name ( ) {
+    std::uint32_t r[ 4 ];
+    detail::cpuid ( r, 0x8000'0000u );
+    if ( r[ 0 ] < 0x8000'0004u )
+        return "unknown";
+    char brand[ 49 ]{ };
+    for ( std::uint32_t l = 0u; l < 3u; ++l ) {
+        detail::cpuid ( r, 0x8000'0002u + l );
+        std::memcpy ( brand + 16 * l, r, 16 );
+    }
+    std::string s ( brand );
+    s.erase ( 0, s.find_first_not_of ( ' ' ) );
+    s.erase ( s.find_last_not_of ( ' ' ) + 1 );
+    return s;
+}
+
+// The kernels as function objects, run<Isa> is the kernel compiled for instruction set Isa. A kernel
+// that uses the integer dot product says so (Vnni).
+
+template<typename Activation, int NumIns, int NumNeurons, typename Weight>
+struct Cascade {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, Weight const * wgt_ ) noexcept {
+        cascade<Isa, Activation, NumIns, NumNeurons> ( ibo_, wgt_ );
+    }
+};
+
+template<typename Activation, int NumIns, int NumNeurons, typename Weight>
+struct CascadeUnrolled {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, Weight const * wgt_ ) noexcept {
+        cascade_unrolled<Isa, Activation, NumIns, NumNeurons> ( ibo_, wgt_ );
+    }
+};
+
+template<typename Activation, int NumIns, int NumNeurons, int Lanes, bool SharedWeights, typename Weight>
+struct CascadeLanes {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, Weight const * wgt_ ) noexcept {
+        cascade_lanes<Isa, Activation, NumIns, NumNeurons, Lanes, SharedWeights> ( ibo_, wgt_ );
+    }
+};
+
+template<typename Activation, int NumIns, int NumNeurons, int RowAlign>
+struct CascadePadded {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, float const * wgt_ ) noexcept {
+        cascade_padded<Isa, Activation, NumIns, NumNeurons, RowAlign> ( ibo_, wgt_ );
+    }
+};
+
+template<typename Activation, int NumIns, int NumNeurons, int RowAlign>
+struct CascadeSplit {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, float const * const inp_, float const * tri_ ) noexcept {
+        cascade_split<Isa, Activation, NumIns, NumNeurons, RowAlign> ( ibo_, inp_, tri_ );
+    }
+};
+
+template<typename Activation, int NumIns, int NumNeurons, int RowAlign, typename Weight>
+struct CascadeQuantized {
+    static constexpr bool Vnni = true;
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, std::int16_t * const act_, Weight const * wgt_, float const * const scales_,
+                                  float const act_max_ ) noexcept {
+        cascade_quantized<Isa, Activation, NumIns, NumNeurons, RowAlign> ( ibo_, act_, wgt_, scales_, act_max_ );
+    }
+};
+
+template<int N>
+struct Axpy {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const acc_, float const a_, float const * const x_ ) noexcept {
+        axpy<Isa, N> ( acc_, a_, x_ );
+    }
+};
+
+template<typename Activation, int NumIns, int NumNeurons, int RowAlign>
+struct Triangle {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, float * const acc_, float const * tri_ ) noexcept {
+        triangle<Isa, Activation, NumIns, NumNeurons, RowAlign> ( ibo_, acc_, tri_ );
+    }
+};
+
+template<typename Activation, int NumIns, int... Widths>
+struct Layered {
+    template<typename Isa>
+    SIMD_INLINE static void run ( float * const ibo_, float const * wgt_ ) noexcept {
+        layered<Isa, Activation, 0, NumIns, Widths...> ( ibo_, wgt_ );
+    }
+};
+
+// The entry points, one per instruction set, the kernel is inlined and compiled for it.
+
+template<typename Kernel, typename... Args>
+void entry_scalar ( Args... args_ ) noexcept {
+    Kernel::template run<scalar> ( args_... );
+}
+
+SIMD_TARGET_BEGIN_SSE42
+template<typename Kernel, typename... Args>
+void entry_sse42 ( Args... args_ ) noexcept {
+    Kernel::template run<sse42> ( args_... );
+}
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX2
+template<typename Kernel, typename... Args>
+void entry_avx2 ( Args... args_ ) noexcept {
+    Kernel::template run<avx2> ( args_... );
+}
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX512
+template<typename Kernel, typename... Args>
+void entry_avx512 ( Args... args_ ) noexcept {
+    Kernel::template run<avx512> ( args_... );
+}
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX2_VNNI
+template<typename Kernel, typename... Args>
+void entry_avx2_vnni ( Args... args_ ) noexcept {
+    Kernel::template run<avx2_vnni> ( args_... );
+}
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX512_VNNI
+template<typename Kernel, typename... Args>
+void entry_avx512_vnni ( Args... args_ ) noexcept {
+    Kernel::template run<avx512_vnni> ( args_... );
+}
+SIMD_TARGET_END
+
+template<typename Kernel>
+using kernel_pointer = decltype ( &Kernel::template run<scalar> );
+
+namespace detail {
+
+template<typename Kernel>
+inline constexpr bool uses_vnni = requires { requires Kernel::Vnni; };
+
+template<typename Kernel, typename... Args>
+[[nodiscard]] kernel_pointer<Kernel> entry ( InstructionSet const is_, void ( * )( Args... ) noexcept ) noexcept {
+    switch ( is_ ) {
+        case InstructionSet::scalar: return entry_scalar<Kernel, Args...>;
+        case InstructionSet::sse42: return entry_sse42<Kernel, Args...>;
+        case InstructionSet::avx2: return entry_avx2<Kernel, Args...>;
+        case InstructionSet::avx2_vnni:
+            if constexpr ( uses_vnni<Kernel> )
+                return entry_avx2_vnni<Kernel, Args...>;
+            else
+                return entry_avx2<Kernel, Args...>;
+        case InstructionSet::avx512: return entry_avx512<Kernel, Args...>;
+        case InstructionSet::avx512_vnni:
+            if constexpr ( uses_vnni<Kernel> )
+                return entry_avx512_vnni<Kernel, Args...>;
+            else
+                return entry_avx512<Kernel, Args...>;
+    }
+    return entry_scalar<Kernel, Args...>;
+}
+
+} // namespace detail
+
+// The entry point of Kernel for instruction set is_.
+template<typename Kernel>
+[[nodiscard]] kernel_pointer<Kernel> entry ( InstructionSet const is_ ) noexcept {
+    return detail::entry<Kernel> ( is_, kernel_pointer<Kernel>{ } );
+}
+
+// Kernel, for the instruction set detected at startup.
+template<typename Kernel>
+inline kernel_pointer<Kernel> const dispatched = entry<Kernel> ( instruction_set ( ) );
+
+} // namespace simd
@@ -0,0 +1,140 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+#include "activation.hpp"
+#include "fcc.hpp"
+
+// Writes a (cascade) network as a self-contained C++ header: a struct with the topology, the weights
+// in a constexpr array (exact, as hexadecimal floats) and a fixed-shape feed-forward. The header
+// includes nothing but <algorithm>, <array>, <cmath> and <utility>, it doesn't allocate and it
+// doesn't call a BLAS.
+namespace standalone {
+
+// The body of the activation function, of x_ (alpha and clamp are members of the struct).
+[[nodiscard]] inline char const * source ( activation::bipolar ) noexcept {
+    return "        return 2.0f / ( 1.0f + std::exp ( -2.0f * alpha * x_ ) ) - 1.0f;\n";
+}
+[[nodiscard]] inline char const * source ( activation::bipolar_rational ) noexcept {
+    return "        float const x = std::min ( std::max ( alpha * x_, -clamp ), clamp ), x2 = x * x;\n"
+           "        return x * ( ( ( x2 + 378.0f ) * x2 + 17'325.0f ) * x2 + 135'135.0f ) /\n"
+           "               ( ( ( 28.0f * x2 + 3'150.0f ) * x2 + 62'370.0f ) * x2 + 135'135.0f );\n";
+}
+[[nodiscard]] inline char const * source ( activation::elliotsig ) noexcept {
+    return "        float const x = alpha * x_;\n"
+           "        return x / ( 1.0f + std::abs ( x ) );\n";
+}
+[[nodiscard]] inline char const * source ( activation::bipolar_clipped ) noexcept {
+    return "        return std::min ( std::max ( alpha * x_, -1.0f ), 1.0f );\n";
+}
+
+// A float literal that reads back exactly.
+inline void write_float ( std::ostream & out_, float const f_ ) { out_ << std::hexfloat << f_ << std::defaultfloat << 'f'; }
+
+// The network (FullyConnectedNeuralNetwork or HalfNeuralNetwork, any with a float operator[]) as the
+// struct name_, the comment_ goes on top of the header.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation, typename Network>
+void write ( std::ostream & out_, Network const & network_, std::string const & name_, std::string const & comment_ ) {
+    using ibo = InputBiasOutput<NumInput, NumNeurons, NumOutput>;
+    out_ << "// " << name_ << ".hpp, " << comment_ << ".\n"
+         << "// A cascade of " << NumNeurons << " neurons on " << NumInput << " inputs, " << NumOutput << " outputs, activation ";
+    for ( wchar_t const * c = activation::name ( Activation{ } ); *c; ++c )
+        out_ << static_cast<char> ( *c );
+    out_ << ". Standalone, generated by SimdNet.\n\n"
+         << "#pragma once\n\n#include <algorithm>\n#include <array>\n#include <cmath>\n#include <utility>\n\n"
+         << "struct " << name_ << " {\n\n"
+         << "    static constexpr int NumInput   = " << NumInput << ";\n"
+         << "    static constexpr int NumNeurons = " << NumNeurons << ";\n"
+         << "    static constexpr int NumOutput  = " << NumOutput << ";\n"
+         << "    static constexpr int NumIns     = NumInput + 1; // The bias.\n"
+         << "    static constexpr int NumInsOuts = NumIns + NumNeurons;\n"
+         << "    static constexpr int NumWeights = " << ibo::NumWeights << ";\n\n";
+    out_ << "    static constexpr float alpha = ";
+    write_float ( out_, Activation::alpha );
+    out_ << ";\n";
+    if constexpr ( requires { Activation::clamp; } ) {
+        out_ << "    static constexpr float clamp = ";
+        write_float ( out_, Activation::clamp );
+        out_ << ";\n";
+    }
+    // The weights of neuron n (over the inputs, the bias and the neurons before it), neuron after neuron.
+    out_ << "\n    static constexpr std::array<float, NumWeights> weights{\n";
+    for ( int w = 0; w < ibo::NumWeights; ++w ) {
+        out_ << ( w % 4 ? " " : "        " );
+        write_float ( out_, network_[ w ] );
+        out_ << ( w + 1 < ibo::NumWeights ? "," : "" ) << ( w % 4 == 3 or w + 1 == ibo::NumWeights ? "\n" : "" );
+    }
+    out_ << "    };\n\n"
+         << "    [[nodiscard]] static float activation ( float const x_ ) noexcept {\n"
+         << source ( Activation{ } ) << "    }\n\n"
+         << "    // The dot product of N weights and inputs, in 8 partial sums (which vectorizes).\n"
+         << "    template<int N>\n"
+         << "    [[nodiscard]] static float dot ( float const * w_, float const * x_ ) noexcept {\n"
+         << "        float sum[ 8 ] = { };\n"
+         << "        int i          = 0;\n"
+         << "        for ( ; i + 8 <= N; i += 8 )\n"
+         << "            for ( int l = 0; l < 8; ++l )\n"
+         << "                sum[ l ] += w_[ i + l ] * x_[ i + l ];\n"
+         << "        for ( int l = 0; i + l < N; ++l )\n"
+         << "            sum[ l ] += w_[ i + l ] * x_[ i + l ];\n"
+         << "        return ( ( sum[ 0 ] + sum[ 4 ] ) + ( sum[ 2 ] + sum[ 6 ] ) ) +\n"
+         << "               ( ( sum[ 1 ] + sum[ 5 ] ) + ( sum[ 3 ] + sum[ 7 ] ) );\n"
+         << "    }\n\n"
+         << "    // The outputs (of the last NumOutput neurons) for the input, neuron N is unrolled, its weights start\n"
+         << "    // at N * NumIns + N * ( N - 1 ) / 2.\n"
+         << "    static void feed_forward ( float const ( &input_ )[ NumInput ], float ( &output_ )[ NumOutput ] ) noexcept {\n"
+         << "        float ibo[ NumInsOuts ];\n"
+         << "        for ( int i = 0; i < NumInput; ++i )\n"
+         << "            ibo[ i ] = input_[ i ];\n"
+         << "        ibo[ NumInput ] = 1.0f;\n"
+         << "        [ &ibo ]<int... N> ( std::integer_sequence<int, N...> ) noexcept {\n"
+         << "            ( ( ibo[ NumIns + N ] =\n"
+         << "                    activation ( dot<NumIns + N> ( weights.data ( ) + N * NumIns + N * ( N - 1 ) / 2, ibo ) ) ),\n"
+         << "              ... );\n"
+         << "        }( std::make_integer_sequence<int, NumNeurons>{ } );\n"
+         << "        for ( int o = 0; o < NumOutput; ++o )\n"
+         << "            output_[ o ] = ibo[ NumInsOuts - NumOutput + o ];\n"
+         << "    }\n"
+         << "};\n";
+}
+
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation, typename Network>
+void write_to_file ( Network const & network_, std::filesystem::path const & path_, std::string const & name_,
+                     std::string const & comment_ ) {
+    std::ofstream ostream ( path_ / ( name_ + ".hpp" ), std::ios::out );
+    write<NumInput, NumNeurons, NumOutput, Activation> ( ostream, network_, name_, comment_ );
+    ostream.flush ( );
+    ostream.close ( );
+}
+
+} // namespace standalone
@@ -38,12 +38,16 @@
 #include <limits>
 #include <random>
 #include <sax/iostream.hpp>
+#include <span>
 
 #include <cereal/archives/binary.hpp>
 #include <cereal/cereal.hpp>
 #include <cereal/types/array.hpp>
 
+#include "activation.hpp"
+#include "dispatch.hpp"
 #include "rng.hpp"
+#include "simd.hpp"
 
 // Space to be used for feed-forward-calculation.
 template<int NumInput, int NumNeurons, int NumOutput>
@@ -80,8 +84,22 @@ struct InputBiasOutput {
     ibo_type m_data;
 };
 
+// The kernel doing the feed-forward-calculation.
+enum class Backend : int { mkl, simd };
+
+// Networks with up to this many weights are fed forward by the fully unrolled cascade (simd backend).
+inline constexpr int MaxUnrolledWeights = 256;
+
+[[nodiscard]] inline wchar_t const * backend_name ( Backend b_ ) noexcept {
+    switch ( b_ ) {
+        case Backend::mkl: return L"mkl";
+        case Backend::simd: return L"simd";
+    }
+    return L"";
+}
+
 // A fully connected feed-forward cascade network.
-template<int NumInput, int NumNeurons, int NumOutput>
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar>
 struct FullyConnectedNeuralNetwork {
 
     static_assert ( NumNeurons >= NumOutput, "number of neurons needs to be equal or larger than the number of required outputs" );
@@ -91,8 +109,9 @@ struct FullyConnectedNeuralNetwork {
     static constexpr int NumInsOuts = NumIns + NumNeurons;
     static constexpr int NumWeights = ( NumNeurons * ( 2 * NumInput + NumBias + NumNeurons ) ) / 2;
 
-    using ibo_type = InputBiasOutput<NumInput, NumNeurons, NumOutput>;
-    using wgt_type = std::array<float, NumWeights>;
+    using ibo_type        = InputBiasOutput<NumInput, NumNeurons, NumOutput>;
+    using wgt_type        = std::array<float, NumWeights>;
+    using activation_type = Activation;
 
     using pointer        = typename wgt_type::pointer;
     using const_pointer  = typename wgt_type::const_pointer;
@@ -104,20 +123,39 @@ struct FullyConnectedNeuralNetwork {
                         [] ( ) noexcept { return std::uniform_real_distribution<float> ( -1.0f, 1.0f ) ( Rng::gen ( ) ); } );
     }
 
+    // The backend used by feed_forward, shared by all networks of this type.
+    static inline Backend backend = Backend::simd;
+
     [[nodiscard]] const_pointer feed_forward ( pointer const ibo_ ) const noexcept {
+        switch ( backend ) {
+            case Backend::mkl: return feed_forward_mkl ( ibo_ );
+            case Backend::simd: return feed_forward_simd ( ibo_ );
+        }
+        return feed_forward_simd ( ibo_ );
+    }
+
+    // One cblas_sdot per neuron.
+    [[nodiscard]] const_pointer feed_forward_mkl ( pointer const ibo_ ) const noexcept {
         const_pointer wgt = m_weights.data ( );
         for ( int i = NumIns; i < NumInsOuts; wgt += i++ )
-            ibo_[ i ] = activation_bipolar ( cblas_sdot ( i, ibo_, 1, wgt, 1 ), 0.25f );
+            ibo_[ i ] = Activation::scalar ( cblas_sdot ( i, ibo_, 1, wgt, 1 ) );
         return ibo_ + NumInsOuts - NumOutput;
     }
 
-    [[nodiscard]] inline float activation_bipolar ( float net_, float const alpha_ ) const noexcept {
-        net_ *= alpha_;
-        return 2.0f / ( 1.0f + std::exp ( -2.0f * net_ ) ) - 1.0f;
+    // One pass over the triangular weight block, no library calls, fully unrolled for small networks.
+    [[nodiscard]] const_pointer feed_forward_simd ( pointer const ibo_ ) const noexcept {
+        if constexpr ( NumWeights <= MaxUnrolledWeights )
+            simd::dispatched<simd::CascadeUnrolled<Activation, NumIns, NumNeurons, float>> ( ibo_, m_weights.data ( ) );
+        else
+            simd::dispatched<simd::Cascade<Activation, NumIns, NumNeurons, float>> ( ibo_, m_weights.data ( ) );
+        return ibo_ + NumInsOuts - NumOutput;
     }
-    [[nodiscard]] inline float activation_elliotsig ( float net_, float const alpha_ ) const noexcept {
-        net_ *= alpha_;
-        return net_ / ( 1.0f + std::abs ( net_ ) );
+
+    // Feed-forward of a batch of inputs, laid out as an InputBiasOutputBatch, one input per lane.
+    template<typename BatchType>
+    void feed_forward_batch ( BatchType & ibo_ ) const noexcept {
+        simd::dispatched<simd::CascadeLanes<Activation, NumIns, NumNeurons, BatchType::NumLanes, true, float>> (
+            ibo_.data ( ), m_weights.data ( ) );
     }
 
     template<typename Stream>
@@ -132,7 +170,7 @@ struct FullyConnectedNeuralNetwork {
     [[nodiscard]] float const & operator[] ( int i_ ) const noexcept { return m_weights[ i_ ]; }
 
     [[nodiscard]] constexpr pointer data ( ) noexcept { return m_weights.data ( ); }
-    [[nodiscard]] constexpr const_pointer * data ( ) const noexcept { return m_weights.data ( ); }
+    [[nodiscard]] constexpr const_pointer data ( ) const noexcept { return m_weights.data ( ); }
 
     [[nodiscard]] iterator begin ( ) noexcept { return iterator ( m_weights.begin ( ) ); }
     [[nodiscard]] iterator end ( ) noexcept { return iterator ( m_weights.end ( ) ); }
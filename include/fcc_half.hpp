@@ -0,0 +1,145 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/array.hpp>
+
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "rng.hpp"
+#include "simd.hpp"
+
+[[nodiscard]] inline wchar_t const * weight_name ( float ) noexcept { return L"fp32"; }
+[[nodiscard]] inline wchar_t const * weight_name ( simd::fp16 ) noexcept { return L"fp16"; }
+[[nodiscard]] inline wchar_t const * weight_name ( simd::bf16 ) noexcept { return L"bf16"; }
+
+// A weight stored in half precision, reads as a float, writes round to nearest even.
+template<typename Weight>
+struct WeightReference {
+
+    operator float ( ) const noexcept { return simd::to_float ( *m_weight ); }
+
+    WeightReference & operator= ( float const f_ ) noexcept {
+        *m_weight = simd::from_float<Weight> ( f_ );
+        return *this;
+    }
+    WeightReference & operator+= ( float const f_ ) noexcept { return operator= ( simd::to_float ( *m_weight ) + f_ ); }
+
+    Weight * m_weight;
+};
+
+// A fully connected feed-forward cascade network, with its weights stored in half precision (fp16
+// or bf16), the kernels widen them to float on the fly. Modifying a weight is done in float, and
+// rounds back. Serialized, the weights are float, as the ones of FullyConnectedNeuralNetwork.
+template<int NumInput, int NumNeurons, int NumOutput, typename Weight = simd::fp16, typename Activation = activation::bipolar>
+struct HalfNeuralNetwork {
+
+    static_assert ( simd::is_half_v<Weight>, "fp16 or bf16 weights only" );
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using weight_type     = Weight;
+    using activation_type = Activation;
+
+    static constexpr int NumBias    = 1;
+    static constexpr int NumIns     = NumInput + NumBias;
+    static constexpr int NumInsOuts = NumIns + NumNeurons;
+    static constexpr int NumWeights = network_type::NumWeights;
+
+    using ibo_type = typename network_type::ibo_type;
+    // The extra (zero) weight covers the partial loads of the last row, which read whole 32-bit words.
+    using wgt_type = std::array<Weight, NumWeights + 1>;
+
+    using pointer        = Weight *;
+    using const_pointer  = Weight const *;
+    using iterator       = pointer;
+    using const_iterator = const_pointer;
+
+    HalfNeuralNetwork ( ) noexcept : m_weights{ } {
+        std::generate ( begin ( ), end ( ), [] ( ) noexcept {
+            return simd::from_float<Weight> ( std::uniform_real_distribution<float> ( -1.0f, 1.0f ) ( Rng::gen ( ) ) );
+        } );
+    }
+
+    explicit HalfNeuralNetwork ( network_type const & network_ ) noexcept : m_weights{ } {
+        for ( int i = 0; i < NumWeights; ++i )
+            m_weights[ i ] = simd::from_float<Weight> ( network_[ i ] );
+    }
+
+    [[nodiscard]] float const * feed_forward ( float * const ibo_ ) const noexcept {
+        if constexpr ( NumWeights <= MaxUnrolledWeights )
+            simd::dispatched<simd::CascadeUnrolled<Activation, NumIns, NumNeurons, Weight>> ( ibo_, m_weights.data ( ) );
+        else
+            simd::dispatched<simd::Cascade<Activation, NumIns, NumNeurons, Weight>> ( ibo_, m_weights.data ( ) );
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    // Feed-forward of a batch of inputs, laid out as an InputBiasOutputBatch, one input per lane.
+    template<typename BatchType>
+    void feed_forward_batch ( BatchType & ibo_ ) const noexcept {
+        simd::dispatched<simd::CascadeLanes<Activation, NumIns, NumNeurons, BatchType::NumLanes, true, Weight>> (
+            ibo_.data ( ), m_weights.data ( ) );
+    }
+
+    [[nodiscard]] WeightReference<Weight> operator[] ( int i_ ) noexcept { return { m_weights.data ( ) + i_ }; }
+    [[nodiscard]] float operator[] ( int i_ ) const noexcept { return simd::to_float ( m_weights[ i_ ] ); }
+
+    [[nodiscard]] constexpr pointer data ( ) noexcept { return m_weights.data ( ); }
+    [[nodiscard]] constexpr const_pointer data ( ) const noexcept { return m_weights.data ( ); }
+
+    [[nodiscard]] iterator begin ( ) noexcept { return m_weights.data ( ); }
+    [[nodiscard]] iterator end ( ) noexcept { return m_weights.data ( ) + NumWeights; }
+    [[nodiscard]] const_iterator begin ( ) const noexcept { return m_weights.data ( ); }
+    [[nodiscard]] const_iterator cbegin ( ) const noexcept { return m_weights.data ( ); }
+    [[nodiscard]] const_iterator end ( ) const noexcept { return m_weights.data ( ) + NumWeights; }
+    [[nodiscard]] const_iterator cend ( ) const noexcept { return m_weights.data ( ) + NumWeights; }
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void save ( Archive & ar_ ) const {
+        typename network_type::wgt_type weights;
+        for ( int i = 0; i < NumWeights; ++i )
+            weights[ i ] = simd::to_float ( m_weights[ i ] );
+        ar_ ( weights );
+    }
+
+    template<class Archive>
+    void load ( Archive & ar_ ) {
+        typename network_type::wgt_type weights;
+        ar_ ( weights );
+        for ( int i = 0; i < NumWeights; ++i )
+            m_weights[ i ] = simd::from_float<Weight> ( weights[ i ] );
+    }
+
+    wgt_type m_weights;
+};
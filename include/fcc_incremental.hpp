@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <span>
+
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "fcc_split.hpp"
+#include "simd.hpp"
+
+// Space to be used for incremental feed-forward-calculation, the layout of the inputs and outputs
+// is the one of InputBiasOutput. Besides those, it keeps the contributions of the inputs to the
+// neurons (the accumulators) of the network that used it last, the inputs these reflect, and the
+// inputs that changed since (reported by whoever writes the inputs, a superset is fine).
+template<int NumInput, int NumNeurons, int NumOutput, int RowAlign = simd::CacheLineFloats>
+struct InputBiasOutputIncremental {
+
+    static_assert ( NumNeurons >= NumOutput, "number of neurons needs to be equal or larger than the number of required outputs" );
+    static_assert ( NumInput <= 32, "the changes are a 32-bit mask" );
+
+    static constexpr int NumBias    = 1;
+    static constexpr int NumIns     = NumInput + NumBias;
+    static constexpr int NumInsOuts = NumIns + NumNeurons;
+    static constexpr int NumAccs    = simd::round_up ( NumNeurons, RowAlign );
+
+    using ibo_type = std::array<float, NumInsOuts>;
+    using acc_type = std::array<float, NumAccs>;
+
+    InputBiasOutputIncremental ( ) noexcept : m_data{ } { m_data[ NumInput ] = 1.0f; }
+
+    constexpr float & operator[] ( int i ) noexcept { return m_data[ i ]; }
+    constexpr float const & operator[] ( int i ) const noexcept { return m_data[ i ]; }
+
+    [[nodiscard]] constexpr float * data ( ) noexcept { return m_data.data ( ); }
+    [[nodiscard]] constexpr float const * data ( ) const noexcept { return m_data.data ( ); }
+
+    [[nodiscard]] constexpr std::span<float> input ( ) noexcept { return { data ( ), NumInput }; }
+    [[nodiscard]] constexpr std::span<float const> input ( ) const noexcept { return { data ( ), NumInput }; }
+
+    // Input i changed, iff bit i of changes_ is set.
+    void changed ( std::uint32_t const changes_ ) noexcept { m_changed |= changes_; }
+
+    ibo_type m_data;
+    alignas ( 64 ) acc_type m_accumulators;
+    std::array<float, NumInput> m_seen;
+    std::uint32_t m_changed = ~std::uint32_t{ 0 };
+    std::uint64_t m_version = 0; // Of the network the accumulators belong to, 0 is none.
+    int m_num_updates       = 0;
+};
+
+// A fully connected feed-forward cascade network, evaluated incrementally (as an NNUE): the input
+// contributions are kept in the work area from one step to the next, only the inputs that changed
+// are applied, as an axpy of their delta with their column of the input block (stored by column).
+// The neurons then run as in SplitNeuralNetwork. The accumulators are recomputed when the work area
+// was last used by another network (or another assign), and every RefreshInterval updates, which
+// bounds the drift of the sums.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar>
+struct IncrementalNeuralNetwork {
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using split_type      = SplitNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using activation_type = Activation;
+
+    static constexpr int RowAlign        = split_type::RowAlign;
+    static constexpr int NumIns          = network_type::NumIns;
+    static constexpr int NumInsOuts      = network_type::NumInsOuts;
+    static constexpr int NumWeights      = network_type::NumWeights;
+    static constexpr int NumAccs         = split_type::NumAccs;
+    static constexpr int RefreshInterval = 256;
+
+    using ibo_type = InputBiasOutputIncremental<NumInput, NumNeurons, NumOutput, RowAlign>;
+    using col_type = std::array<float, NumIns * NumAccs>;
+    using tri_type = typename split_type::tri_type;
+
+    using pointer       = float *;
+    using const_pointer = float const *;
+
+    IncrementalNeuralNetwork ( ) noexcept : m_columns{ }, m_triangle{ } {}
+    explicit IncrementalNeuralNetwork ( network_type const & network_ ) noexcept : m_columns{ }, m_triangle{ } {
+        assign ( network_ );
+    }
+
+    // Copy the weights of a network (of any weight type), the padding stays zero.
+    template<typename Network>
+    void assign ( Network const & network_ ) noexcept {
+        for ( int n = 0; n < NumNeurons; ++n ) {
+            int const p = split_type::packed_offset ( n );
+            for ( int i = 0; i < NumIns; ++i )
+                m_columns[ i * NumAccs + n ] = network_[ p + i ];
+            for ( int m = 0; m < n; ++m )
+                m_triangle[ split_type::triangle_index ( m, n ) ] = network_[ p + NumIns + m ];
+        }
+        m_version = s_version.fetch_add ( 1, std::memory_order_relaxed );
+    }
+
+    [[nodiscard]] const_pointer feed_forward ( ibo_type & ibo_ ) const noexcept {
+        float * const accumulators = ibo_.m_accumulators.data ( );
+        if ( ibo_.m_version != m_version or RefreshInterval == ibo_.m_num_updates ) {
+            std::fill_n ( accumulators, NumAccs, 0.0f );
+            for ( int i = 0; i < NumIns; ++i )
+                simd::dispatched<simd::Axpy<NumAccs>> ( accumulators, ibo_[ i ], m_columns.data ( ) + i * NumAccs );
+            std::copy_n ( ibo_.data ( ), NumInput, ibo_.m_seen.data ( ) );
+            ibo_.m_version     = m_version;
+            ibo_.m_num_updates = 0;
+        }
+        else {
+            for ( std::uint32_t c = ibo_.m_changed; c; c &= c - 1 ) {
+                int const i       = std::countr_zero ( c );
+                float const delta = ibo_[ i ] - ibo_.m_seen[ i ];
+                if ( 0.0f != delta ) {
+                    simd::dispatched<simd::Axpy<NumAccs>> ( accumulators, delta, m_columns.data ( ) + i * NumAccs );
+                    ibo_.m_seen[ i ] = ibo_[ i ];
+                    ++ibo_.m_num_updates;
+                }
+            }
+        }
+        ibo_.m_changed = 0;
+        alignas ( 64 ) float acc[ NumAccs ];
+        std::copy_n ( accumulators, NumAccs, acc );
+        simd::dispatched<simd::Triangle<Activation, NumIns, NumNeurons, RowAlign>> ( ibo_.data ( ), acc, m_triangle.data ( ) );
+        return ibo_.data ( ) + NumInsOuts - NumOutput;
+    }
+
+    private:
+    static inline std::atomic<std::uint64_t> s_version = 1;
+
+    alignas ( 64 ) col_type m_columns;
+    alignas ( 64 ) tri_type m_triangle;
+    std::uint64_t m_version = s_version.fetch_add ( 1, std::memory_order_relaxed );
+};
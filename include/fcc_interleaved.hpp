@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "simd.hpp"
+
+// The number of networks evaluated side by side, a multiple of the vector width of all instruction sets.
+inline constexpr int NumLanes = simd::avx512::width;
+
+// Space to be used for feed-forward-calculation of Lanes networks at once, value i of lane l
+// lives at [ i * Lanes + l ].
+template<int NumInput, int NumNeurons, int NumOutput, int Lanes = NumLanes>
+struct InputBiasOutputBatch {
+
+    static_assert ( NumNeurons >= NumOutput, "number of neurons needs to be equal or larger than the number of required outputs" );
+
+    static constexpr int NumLanes   = Lanes;
+    static constexpr int NumBias    = 1;
+    static constexpr int NumIns     = NumInput + NumBias;
+    static constexpr int NumInsOuts = NumIns + NumNeurons;
+
+    using ibo_type = std::array<float, NumInsOuts * Lanes>;
+
+    // Lanes that are not fed, compute on zeros.
+    InputBiasOutputBatch ( ) noexcept : m_data{ } { std::fill_n ( m_data.data ( ) + NumInput * Lanes, Lanes, 1.0f ); }
+
+    [[nodiscard]] constexpr float * data ( ) noexcept { return m_data.data ( ); }
+    [[nodiscard]] constexpr float const * data ( ) const noexcept { return m_data.data ( ); }
+
+    // Scatter the (contiguous) input of a lane.
+    void input ( int const lane_, float const * const input_ ) noexcept {
+        for ( int i = 0; i < NumInput; ++i )
+            m_data[ i * Lanes + lane_ ] = input_[ i ];
+    }
+
+    // Gather the (contiguous) output of a lane.
+    void output ( int const lane_, float * const output_ ) const noexcept {
+        for ( int i = 0; i < NumOutput; ++i )
+            output_[ i ] = m_data[ ( NumInsOuts - NumOutput + i ) * Lanes + lane_ ];
+    }
+
+    alignas ( 64 ) ibo_type m_data;
+};
+
+// Lanes fully connected feed-forward cascade networks, with interleaved weights.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar, int Lanes = NumLanes>
+struct InterleavedNeuralNetwork {
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using activation_type = Activation;
+
+    static constexpr int NumLanes   = Lanes;
+    static constexpr int NumIns     = network_type::NumIns;
+    static constexpr int NumInsOuts = network_type::NumInsOuts;
+    static constexpr int NumWeights = network_type::NumWeights;
+
+    using ibo_type = InputBiasOutputBatch<NumInput, NumNeurons, NumOutput, Lanes>;
+    using wgt_type = std::array<float, NumWeights * Lanes>;
+
+    // Copy the weights of a network (of any weight type) into a lane.
+    template<typename Network>
+    void assign ( int const lane_, Network const & network_ ) noexcept {
+        for ( int i = 0; i < NumWeights; ++i )
+            m_weights[ i * Lanes + lane_ ] = network_[ i ];
+    }
+
+    void feed_forward ( ibo_type & ibo_ ) const noexcept {
+        simd::dispatched<simd::CascadeLanes<Activation, NumIns, NumNeurons, Lanes, false, float>> ( ibo_.data ( ),
+                                                                                                   m_weights.data ( ) );
+    }
+
+    alignas ( 64 ) wgt_type m_weights;
+};
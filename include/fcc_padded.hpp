@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/array.hpp>
+
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "simd.hpp"
+
+// Space to be used for feed-forward-calculation of a padded network, aligned and zero-padded to
+// a whole number of rows (of RowAlign floats).
+template<int NumInput, int NumNeurons, int NumOutput, int RowAlign = simd::CacheLineFloats>
+struct InputBiasOutputPadded {
+
+    static_assert ( NumNeurons >= NumOutput, "number of neurons needs to be equal or larger than the number of required outputs" );
+
+    static constexpr int NumBias    = 1;
+    static constexpr int NumIns     = NumInput + NumBias;
+    static constexpr int NumInsOuts = NumIns + NumNeurons;
+    static constexpr int NumPadded  = simd::round_up ( NumInsOuts, RowAlign );
+
+    using ibo_type = std::array<float, NumPadded>;
+
+    InputBiasOutputPadded ( ) noexcept : m_data{ } { m_data[ NumInput ] = 1.0f; }
+
+    constexpr float & operator[] ( int i ) noexcept { return m_data[ i ]; }
+    constexpr float const & operator[] ( int i ) const noexcept { return m_data[ i ]; }
+
+    [[nodiscard]] constexpr float * data ( ) noexcept { return m_data.data ( ); }
+    [[nodiscard]] constexpr float const * data ( ) const noexcept { return m_data.data ( ); }
+
+    [[nodiscard]] constexpr std::span<float> input ( ) noexcept { return { data ( ), NumInput }; }
+    [[nodiscard]] constexpr std::span<float const> input ( ) const noexcept { return { data ( ), NumInput }; }
+
+    alignas ( 64 ) ibo_type m_data;
+};
+
+// A fully connected feed-forward cascade network, with every row of weights starting on a cache
+// line and zero-padded to a whole number of cache lines. The weights convert to and from the
+// packed layout of FullyConnectedNeuralNetwork, which is also the serialized form.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar>
+struct PaddedNeuralNetwork {
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using activation_type = Activation;
+
+    static constexpr int RowAlign   = simd::CacheLineFloats;
+    static constexpr int NumIns     = network_type::NumIns;
+    static constexpr int NumInsOuts = network_type::NumInsOuts;
+    static constexpr int NumWeights = network_type::NumWeights;
+
+    // The offset of row n in the padded layout, row n has NumIns + n weights.
+    [[nodiscard]] static constexpr int row_offset ( int n_ ) noexcept {
+        int o = 0;
+        for ( int n = 0; n < n_; ++n )
+            o += simd::round_up ( NumIns + n, RowAlign );
+        return o;
+    }
+
+    static constexpr int NumPaddedWeights = row_offset ( NumNeurons );
+
+    using ibo_type = InputBiasOutputPadded<NumInput, NumNeurons, NumOutput, RowAlign>;
+    using wgt_type = std::array<float, NumPaddedWeights>;
+
+    using pointer       = float *;
+    using const_pointer = float const *;
+
+    PaddedNeuralNetwork ( ) noexcept : m_weights{ } {}
+    explicit PaddedNeuralNetwork ( network_type const & network_ ) noexcept : m_weights{ } { from_packed ( network_.data ( ) ); }
+
+    // Read NumWeights weights in the packed layout, the padding stays zero.
+    void from_packed ( const_pointer packed_ ) noexcept {
+        for ( int n = 0; n < NumNeurons; packed_ += NumIns + n++ )
+            std::copy_n ( packed_, NumIns + n, m_weights.data ( ) + row_offset ( n ) );
+    }
+
+    // Write NumWeights weights in the packed layout.
+    void to_packed ( pointer packed_ ) const noexcept {
+        for ( int n = 0; n < NumNeurons; packed_ += NumIns + n++ )
+            std::copy_n ( m_weights.data ( ) + row_offset ( n ), NumIns + n, packed_ );
+    }
+
+    // Copy the weights of a network (of any weight type).
+    template<typename Network>
+    void assign ( Network const & network_ ) noexcept {
+        for ( int n = 0, i = 0; n < NumNeurons; ++n ) {
+            float * const row = m_weights.data ( ) + row_offset ( n );
+            for ( int j = 0; j < NumIns + n; ++j )
+                row[ j ] = network_[ i++ ];
+        }
+    }
+
+    [[nodiscard]] const_pointer feed_forward ( pointer const ibo_ ) const noexcept {
+        simd::dispatched<simd::CascadePadded<Activation, NumIns, NumNeurons, RowAlign>> ( ibo_, m_weights.data ( ) );
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    [[nodiscard]] constexpr pointer data ( ) noexcept { return m_weights.data ( ); }
+    [[nodiscard]] constexpr const_pointer data ( ) const noexcept { return m_weights.data ( ); }
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void save ( Archive & ar_ ) const {
+        typename network_type::wgt_type packed;
+        to_packed ( packed.data ( ) );
+        ar_ ( packed );
+    }
+
+    template<class Archive>
+    void load ( Archive & ar_ ) {
+        typename network_type::wgt_type packed;
+        ar_ ( packed );
+        from_packed ( packed.data ( ) );
+    }
+
+    alignas ( 64 ) wgt_type m_weights;
+};
@@ -0,0 +1,128 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "simd.hpp"
+
+// The precision of the brains used for evaluation, the genome stays fp32.
+enum class Quantization : int { none, int16, int8 };
+
+[[nodiscard]] inline wchar_t const * quantization_name ( Quantization q_ ) noexcept {
+    switch ( q_ ) {
+        case Quantization::none: return L"none";
+        case Quantization::int16: return L"int16";
+        case Quantization::int8: return L"int8";
+    }
+    return L"";
+}
+
+// The quantized mirror of a FullyConnectedNeuralNetwork, made from its weights (assign). The weights
+// of neuron n are scaled to [ -WeightMax, WeightMax ] by their own scale, the inputs and outputs of
+// the neurons (all in [ -1, 1 ]) to 16 bits of fixed point, the dot products are integer. The work
+// area is the one of the fp32 network, inputs and outputs are fp32.
+template<int NumInput, int NumNeurons, int NumOutput, typename Weight = std::int16_t, typename Activation = activation::bipolar>
+struct QuantizedNeuralNetwork {
+
+    static_assert ( std::is_same_v<Weight, std::int16_t> or std::is_same_v<Weight, std::int8_t>, "int16 or int8 weights only" );
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using weight_type     = Weight;
+    using activation_type = Activation;
+
+    static constexpr int NumIns     = network_type::NumIns;
+    static constexpr int NumInsOuts = network_type::NumInsOuts;
+    static constexpr int NumWeights = network_type::NumWeights;
+
+    // Rows of weights start at, and are zero-padded to, a multiple of RowAlign elements.
+    static constexpr int RowAlign        = 32;
+    static constexpr int WeightMax       = std::is_same_v<Weight, std::int8_t> ? 127 : 4'095;
+    static constexpr float ActivationMax = 4'096.0f;
+
+    // A product is at most 2^24 in magnitude, the 32-bit sum of NumInsOuts - 1 of them can't overflow up
+    // to 128 inputs and outputs, wider networks are not supported (and can't be fed forward).
+    static constexpr bool Supported = NumInsOuts <= 128;
+
+    [[nodiscard]] static constexpr int row_offset ( int n_ ) noexcept {
+        int o = 0;
+        for ( int n = 0; n < n_; ++n )
+            o += simd::round_up ( NumIns + n, RowAlign );
+        return o;
+    }
+
+    static constexpr int NumPaddedWeights = row_offset ( NumNeurons );
+    static constexpr int NumActivations   = simd::round_up ( NumInsOuts, RowAlign );
+
+    using ibo_type = typename network_type::ibo_type;
+    using wgt_type = std::array<Weight, NumPaddedWeights>;
+
+    using pointer       = float *;
+    using const_pointer = float const *;
+
+    QuantizedNeuralNetwork ( ) noexcept : m_weights{ }, m_scales{ } {}
+    explicit QuantizedNeuralNetwork ( network_type const & network_ ) noexcept : m_weights{ }, m_scales{ } { assign ( network_ ); }
+
+    // Quantize the weights of a network (of any weight type).
+    template<typename Network>
+    void assign ( Network const & network_ ) noexcept {
+        Weight * q = m_weights.data ( );
+        for ( int n = 0, row = 0; n < NumNeurons; row += NumIns + n, q += simd::round_up ( NumIns + n, RowAlign ), ++n ) {
+            float m = 0.0f;
+            for ( int i = 0; i < NumIns + n; ++i )
+                m = std::max ( m, std::abs ( static_cast<float> ( network_[ row + i ] ) ) );
+            float const s = m > 0.0f ? WeightMax / m : 1.0f;
+            for ( int i = 0; i < NumIns + n; ++i )
+                q[ i ] = static_cast<Weight> ( std::lrint ( network_[ row + i ] * s ) );
+            m_scales[ n ] = 1.0f / ( s * ActivationMax );
+        }
+    }
+
+    [[nodiscard]] const_pointer feed_forward ( pointer const ibo_ ) const noexcept {
+        static_assert ( Supported, "the integer dot product could overflow" );
+        alignas ( 64 ) std::array<std::int16_t, NumActivations> a{ };
+        for ( int i = 0; i < NumIns; ++i )
+            a[ i ] = quantize ( ibo_[ i ] );
+        simd::dispatched<simd::CascadeQuantized<Activation, NumIns, NumNeurons, RowAlign, Weight>> (
+            ibo_, a.data ( ), m_weights.data ( ), m_scales.data ( ), ActivationMax );
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    private:
+    // Clamped to [ -1, 1 ], which bounds the dot product.
+    [[nodiscard]] static std::int16_t quantize ( float const f_ ) noexcept {
+        return static_cast<std::int16_t> ( std::lrint ( std::clamp ( f_, -1.0f, 1.0f ) * ActivationMax ) );
+    }
+
+    alignas ( 64 ) wgt_type m_weights;
+    std::array<float, NumNeurons> m_scales;
+};
@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/array.hpp>
+
+#include "fcc.hpp"
+
+// A fully connected feed-forward cascade network with its live connections only, a pruned (switched
+// off) connection being a weight of exactly zero in the packed layout of FullyConnectedNeuralNetwork.
+// The live connections of neuron n are compressed in [ offset n, offset n + 1 ), an index into the
+// work area plus a weight each, so the cost of feed_forward scales with the number of live connections.
+// The weights convert to and from the packed layout, which is also the serialized form.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar>
+struct SparseNeuralNetwork {
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using activation_type = Activation;
+
+    static constexpr int NumIns     = network_type::NumIns;
+    static constexpr int NumInsOuts = network_type::NumInsOuts;
+    static constexpr int NumWeights = network_type::NumWeights;
+
+    using index_type = std::uint16_t;
+
+    static_assert ( NumInsOuts <= 65'536, "the work area needs to be indexable by an index_type" );
+
+    using ibo_type = typename network_type::ibo_type;
+    using off_type = std::array<int, NumNeurons + 1>;
+    using idx_type = std::array<index_type, NumWeights>;
+    using wgt_type = std::array<float, NumWeights>;
+
+    using pointer       = float *;
+    using const_pointer = float const *;
+
+    SparseNeuralNetwork ( ) noexcept : m_offsets{ }, m_indices{ }, m_weights{ } {}
+    explicit SparseNeuralNetwork ( network_type const & network_ ) noexcept : m_offsets{ }, m_indices{ }, m_weights{ } {
+        assign ( network_ );
+    }
+
+    // Copy the non-zero weights of a network (of any weight type).
+    template<typename Network>
+    void assign ( Network const & network_ ) noexcept {
+        int k = 0;
+        for ( int n = 0, p = 0; n < NumNeurons; p += NumIns + n++ ) {
+            m_offsets[ n ] = k;
+            for ( int i = 0; i < NumIns + n; ++i ) {
+                float const w = network_[ p + i ];
+                if ( 0.0f != w ) {
+                    m_indices[ k ]   = static_cast<index_type> ( i );
+                    m_weights[ k++ ] = w;
+                }
+            }
+        }
+        m_offsets[ NumNeurons ] = k;
+    }
+
+    // Write NumWeights weights in the packed layout, the pruned ones as zero.
+    void to_packed ( pointer packed_ ) const noexcept {
+        std::fill_n ( packed_, NumWeights, 0.0f );
+        for ( int n = 0; n < NumNeurons; packed_ += NumIns + n++ )
+            for ( int k = m_offsets[ n ]; k < m_offsets[ n + 1 ]; ++k )
+                packed_[ m_indices[ k ] ] = m_weights[ k ];
+    }
+
+    [[nodiscard]] int num_connections ( ) const noexcept { return m_offsets[ NumNeurons ]; }
+
+    // Four independent sums per neuron, the loads from the work area are gathers.
+    [[nodiscard]] const_pointer feed_forward ( pointer const ibo_ ) const noexcept {
+        for ( int n = 0; n < NumNeurons; ++n ) {
+            int k = m_offsets[ n ], e = m_offsets[ n + 1 ];
+            float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+            for ( ; k + 4 <= e; k += 4 ) {
+                a0 += m_weights[ k + 0 ] * ibo_[ m_indices[ k + 0 ] ];
+                a1 += m_weights[ k + 1 ] * ibo_[ m_indices[ k + 1 ] ];
+                a2 += m_weights[ k + 2 ] * ibo_[ m_indices[ k + 2 ] ];
+                a3 += m_weights[ k + 3 ] * ibo_[ m_indices[ k + 3 ] ];
+            }
+            for ( ; k < e; ++k )
+                a0 += m_weights[ k ] * ibo_[ m_indices[ k ] ];
+            ibo_[ NumIns + n ] = Activation::scalar ( ( a0 + a1 ) + ( a2 + a3 ) );
+        }
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void save ( Archive & ar_ ) const {
+        typename network_type::wgt_type packed;
+        to_packed ( packed.data ( ) );
+        ar_ ( packed );
+    }
+
+    template<class Archive>
+    void load ( Archive & ar_ ) {
+        typename network_type::wgt_type packed;
+        ar_ ( packed );
+        assign ( packed );
+    }
+
+    off_type m_offsets;
+    idx_type m_indices;
+    alignas ( 64 ) wgt_type m_weights;
+};
@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/array.hpp>
+
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "simd.hpp"
+
+// A fully connected feed-forward cascade network, with its weights split in an input block (row n,
+// the weights of the inputs to neuron n) and a triangular block stored by column (column n, the
+// weights of neuron n to the later neurons), as required by simd::cascade_split. Made for wide
+// networks. The weights convert to and from the packed layout of FullyConnectedNeuralNetwork,
+// which is also the serialized form.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar>
+struct SplitNeuralNetwork {
+
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using activation_type = Activation;
+
+    static constexpr int RowAlign   = simd::CacheLineFloats;
+    static constexpr int NumIns     = network_type::NumIns;
+    static constexpr int NumInsOuts = network_type::NumInsOuts;
+    static constexpr int NumWeights = network_type::NumWeights;
+    static constexpr int RowLength  = simd::round_up ( NumIns, RowAlign );
+    static constexpr int NumAccs    = simd::round_up ( NumNeurons, RowAlign );
+
+    // From this number of neurons on, the split evaluation is faster than the cascade.
+    static constexpr int MinNumNeurons = 32;
+
+    // The offset of row n in the packed layout.
+    [[nodiscard]] static constexpr int packed_offset ( int n_ ) noexcept { return n_ * NumIns + ( n_ * ( n_ - 1 ) ) / 2; }
+    // The first neuron covered by column n.
+    [[nodiscard]] static constexpr int column_first ( int n_ ) noexcept { return ( ( n_ + 1 ) / RowAlign ) * RowAlign; }
+    // The offset of column n in the triangular block, the sum of NumAccs - column_first ( m ) over
+    // m < n, in closed form (column_first steps by RowAlign every RowAlign columns).
+    [[nodiscard]] static constexpr int column_offset ( int n_ ) noexcept {
+        int const q = n_ / RowAlign, r = n_ % RowAlign;
+        return n_ * NumAccs - RowAlign * ( RowAlign * ( ( q * ( q - 1 ) ) / 2 ) + q * ( r + 1 ) );
+    }
+    // The index of the weight of neuron m to neuron n (m < n) in the triangular block.
+    [[nodiscard]] static constexpr int triangle_index ( int m_, int n_ ) noexcept {
+        return column_offset ( m_ ) + n_ - column_first ( m_ );
+    }
+
+    using ibo_type = typename network_type::ibo_type;
+    using inp_type = std::array<float, NumNeurons * RowLength>;
+    using tri_type = std::array<float, column_offset ( NumNeurons )>;
+
+    using pointer       = float *;
+    using const_pointer = float const *;
+
+    SplitNeuralNetwork ( ) noexcept : m_inputs{ }, m_triangle{ } {}
+    explicit SplitNeuralNetwork ( network_type const & network_ ) noexcept : m_inputs{ }, m_triangle{ } { assign ( network_ ); }
+
+    // Copy the weights of a network (of any weight type), the padding stays zero.
+    template<typename Network>
+    void assign ( Network const & network_ ) noexcept {
+        for ( int n = 0; n < NumNeurons; ++n ) {
+            int const p = packed_offset ( n );
+            for ( int i = 0; i < NumIns; ++i )
+                m_inputs[ n * RowLength + i ] = network_[ p + i ];
+            for ( int m = 0; m < n; ++m )
+                m_triangle[ triangle_index ( m, n ) ] = network_[ p + NumIns + m ];
+        }
+    }
+
+    // Write NumWeights weights in the packed layout.
+    void to_packed ( pointer packed_ ) const noexcept {
+        for ( int n = 0; n < NumNeurons; ++n ) {
+            std::copy_n ( m_inputs.data ( ) + n * RowLength, NumIns, packed_ );
+            packed_ += NumIns;
+            for ( int m = 0; m < n; ++m )
+                *packed_++ = m_triangle[ triangle_index ( m, n ) ];
+        }
+    }
+
+    [[nodiscard]] const_pointer feed_forward ( pointer const ibo_ ) const noexcept {
+        simd::dispatched<simd::CascadeSplit<Activation, NumIns, NumNeurons, RowAlign>> ( ibo_, m_inputs.data ( ),
+                                                                                          m_triangle.data ( ) );
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void save ( Archive & ar_ ) const {
+        typename network_type::wgt_type packed;
+        to_packed ( packed.data ( ) );
+        ar_ ( packed );
+    }
+
+    template<class Archive>
+    void load ( Archive & ar_ ) {
+        typename network_type::wgt_type packed;
+        ar_ ( packed );
+        assign ( packed );
+    }
+
+    alignas ( 64 ) inp_type m_inputs;
+    alignas ( 64 ) tri_type m_triangle;
+};
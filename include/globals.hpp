@@ -23,6 +23,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -149,3 +152,8 @@ void set_cursor_position ( int x_, int y_ ) noexcept;
 void write_buffer ( std::wostringstream const & outbuf_ ) noexcept;
 
 [[nodiscard]] bool hide_cursor ( ) noexcept;
+
+// Executable memory (for the jit), allocated read/write, protect_executable makes it read/execute.
+[[nodiscard]] void * allocate_executable ( std::size_t size_ ) noexcept;
+[[nodiscard]] bool protect_executable ( void * p_, std::size_t size_ ) noexcept;
+void free_executable ( void * p_, std::size_t size_ ) noexcept;
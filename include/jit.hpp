@@ -0,0 +1,375 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+#include "activation.hpp"
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "globals.hpp"
+
+// A jit for a single network, the weights are baked into a constant pool (in front of the code), the
+// code is straight-line x86-64 (sse, plus fma if the cpu has it, xmm0-4 only, all of them volatile in
+// both abi's). The work area is addressed through rbx.
+namespace jit {
+
+#if defined( _M_X64 ) or defined( __x86_64__ )
+inline constexpr bool Supported = true;
+#else
+inline constexpr bool Supported = false;
+#endif
+
+// Just the instructions the cascade needs, the memory operands are [ rbx + disp32 ] (the work area)
+// or [ rip + disp32 ] (the constant pool, the code starts code_offset_ bytes after the pool).
+class Emitter {
+
+    public:
+    Emitter ( int const code_offset_, bool const fma_ ) noexcept : m_code_offset{ code_offset_ }, m_fma{ fma_ } {}
+
+    // Prologue, ibo (the first argument) to rbx, plus the shadow space of win64, the stack stays aligned.
+    void enter ( ) {
+        bytes ( { 0x53 } ); // push rbx
+#if defined( _WIN32 )
+        bytes ( { 0x48, 0x89, 0xCB } ); // mov rbx, rcx
+#else
+        bytes ( { 0x48, 0x89, 0xFB } ); // mov rbx, rdi
+#endif
+        bytes ( { 0x48, 0x83, 0xEC, 0x20 } ); // sub rsp, 32
+    }
+
+    void leave ( ) {
+        bytes ( { 0x48, 0x83, 0xC4, 0x20 } ); // add rsp, 32
+        bytes ( { 0x5B, 0xC3 } );             // pop rbx, ret
+    }
+
+    // Packed and scalar single operations, register-register (dst_, src_) or register-memory.
+    enum Op : std::uint8_t { mov = 0x10, store = 0x11, bitand_ = 0x54, add = 0x58, mul = 0x59, min = 0x5D, div = 0x5E, max = 0x5F };
+
+    void ps ( Op const op_, int const dst_, int const src_ ) {
+        bytes ( { 0x0F, static_cast<std::uint8_t> ( op_ == mov ? 0x28 : op_ ), rr ( dst_, src_ ) } ); // movaps for mov
+    }
+    void ss ( Op const op_, int const dst_, int const src_ ) { bytes ( { 0xF3, 0x0F, op_, rr ( dst_, src_ ) } ); }
+
+    // op xmm, [ rbx + disp_ ], movups for mov.
+    void ps_ibo ( Op const op_, int const reg_, int const disp_ ) {
+        bytes ( { 0x0F, op_, rm_rbx ( reg_ ) } );
+        dword ( disp_ );
+    }
+    // op xmm, [ rbx + disp_ ], or the store of xmm to it.
+    void ss_ibo ( Op const op_, int const reg_, int const disp_ ) {
+        bytes ( { 0xF3, 0x0F, op_, rm_rbx ( reg_ ) } );
+        dword ( disp_ );
+    }
+    // op xmm, [ pool + offset_ ], the pool entry is 16 bytes aligned.
+    void ps_pool ( Op const op_, int const reg_, int const offset_ ) {
+        bytes ( { 0x0F, op_, rm_rip ( reg_ ) } );
+        rip ( offset_ );
+    }
+    void ss_pool ( Op const op_, int const reg_, int const offset_ ) {
+        bytes ( { 0xF3, 0x0F, op_, rm_rip ( reg_ ) } );
+        rip ( offset_ );
+    }
+
+    // dst_ = dst_ * src_ + [ pool + offset_ ] (vfmadd213ss).
+    void madd ( int const dst_, int const src_, int const offset_ ) {
+        if ( m_fma ) {
+            vex ( 0xA9, dst_, src_ );
+            rip ( offset_ );
+        }
+        else {
+            ss ( mul, dst_, src_ );
+            ss_pool ( add, dst_, offset_ );
+        }
+    }
+    // dst_ += src_ * [ pool + offset_ ] (vfmadd231ss, or vfmadd231ps for packed_), src_ is clobbered without fma.
+    void macc ( int const dst_, int const src_, int const offset_, bool const packed_ = false ) {
+        if ( m_fma ) {
+            vex ( packed_ ? 0xB8 : 0xB9, dst_, src_ );
+            rip ( offset_ );
+        }
+        else if ( packed_ ) {
+            ps_pool ( mul, src_, offset_ );
+            ps ( add, dst_, src_ );
+        }
+        else {
+            ss_pool ( mul, src_, offset_ );
+            ss ( add, dst_, src_ );
+        }
+    }
+
+    void zero ( int const reg_ ) { bytes ( { 0x0F, 0x57, rr ( reg_, reg_ ) } ); } // xorps
+
+    // xmm0 = the sum of the lanes of xmm0, xmm1 is clobbered.
+    void hsum ( ) {
+        ps ( mov, 1, 0 );
+        bytes ( { 0x0F, 0x12, rr ( 1, 0 ) } ); // movhlps xmm1, xmm0
+        ps ( add, 0, 1 );
+        ps ( mov, 1, 0 );
+        bytes ( { 0x0F, 0xC6, rr ( 1, 1 ), 0x55 } ); // shufps xmm1, xmm1, 0x55
+        ss ( add, 0, 1 );
+    }
+
+    // xmm0 = f_ ( xmm0 ).
+    void call ( float ( *f_ ) ( float ) noexcept ) {
+        bytes ( { 0x48, 0xB8 } ); // mov rax, imm64
+        std::uint64_t const a = reinterpret_cast<std::uint64_t> ( f_ );
+        for ( int i = 0; i < 8; ++i )
+            m_code.push_back ( static_cast<std::uint8_t> ( a >> ( 8 * i ) ) );
+        bytes ( { 0xFF, 0xD0 } ); // call rax
+    }
+
+    [[nodiscard]] std::vector<std::uint8_t> const & code ( ) const noexcept { return m_code; }
+
+    private:
+    [[nodiscard]] static std::uint8_t rr ( int const dst_, int const src_ ) noexcept {
+        return static_cast<std::uint8_t> ( 0xC0 | dst_ << 3 | src_ );
+    }
+    [[nodiscard]] static std::uint8_t rm_rbx ( int const reg_ ) noexcept {
+        return static_cast<std::uint8_t> ( 0x80 | reg_ << 3 | 3 );
+    }
+    [[nodiscard]] static std::uint8_t rm_rip ( int const reg_ ) noexcept { return static_cast<std::uint8_t> ( reg_ << 3 | 5 ); }
+
+    // The three byte vex prefix (0f38 map, 66 prefix, w0, l0) plus the opcode and the rip-relative modrm.
+    void vex ( std::uint8_t const opcode_, int const dst_, int const src_ ) {
+        bytes ( { 0xC4, 0xE2, static_cast<std::uint8_t> ( 0x01 | ( ~src_ & 15 ) << 3 ), opcode_, rm_rip ( dst_ ) } );
+    }
+
+    void bytes ( std::initializer_list<std::uint8_t> b_ ) { m_code.insert ( std::end ( m_code ), b_ ); }
+
+    void dword ( std::int32_t const d_ ) {
+        for ( int i = 0; i < 4; ++i )
+            m_code.push_back ( static_cast<std::uint8_t> ( static_cast<std::uint32_t> ( d_ ) >> ( 8 * i ) ) );
+    }
+
+    // The displacement (the last field of the instruction) is relative to the end of the instruction.
+    void rip ( int const offset_ ) { dword ( offset_ - ( m_code_offset + static_cast<int> ( m_code.size ( ) ) + 4 ) ); }
+
+    int m_code_offset;
+    bool m_fma;
+    std::vector<std::uint8_t> m_code;
+};
+
+// The constant pool, floats, single ones, or 4 of them (16 bytes aligned).
+class Pool {
+
+    public:
+    [[nodiscard]] int scalar ( float const f_ ) {
+        m_pool.push_back ( f_ );
+        return static_cast<int> ( sizeof ( float ) * ( m_pool.size ( ) - 1 ) );
+    }
+
+    [[nodiscard]] int vector ( float const * const f_ ) {
+        while ( m_pool.size ( ) % 4 )
+            m_pool.push_back ( 0.0f );
+        m_pool.insert ( std::end ( m_pool ), f_, f_ + 4 );
+        return static_cast<int> ( sizeof ( float ) * ( m_pool.size ( ) - 4 ) );
+    }
+
+    [[nodiscard]] int broadcast ( float const f_ ) {
+        float const v[ 4 ]{ f_, f_, f_, f_ };
+        return vector ( v );
+    }
+
+    [[nodiscard]] std::vector<float> const & data ( ) const noexcept { return m_pool; }
+
+    private:
+    std::vector<float> m_pool;
+};
+
+// The activation policies with a closed form are inlined (on xmm0, xmm1-3 are clobbered), any other
+// one is called.
+template<typename Activation>
+void activation ( Emitter & e_, Pool & p_ ) {
+    using E = Emitter;
+    if constexpr ( std::is_same_v<Activation, activation::bipolar_clipped> ) {
+        e_.ss_pool ( E::mul, 0, p_.scalar ( Activation::alpha ) );
+        e_.ss_pool ( E::max, 0, p_.scalar ( -1.0f ) );
+        e_.ss_pool ( E::min, 0, p_.scalar ( 1.0f ) );
+    }
+    else if constexpr ( std::is_same_v<Activation, activation::elliotsig> ) {
+        e_.ss_pool ( E::mul, 0, p_.scalar ( Activation::alpha ) );
+        e_.ps ( E::mov, 1, 0 );
+        e_.ps_pool ( E::bitand_, 1, p_.broadcast ( std::bit_cast<float> ( 0x7FFF'FFFFu ) ) );
+        e_.ss_pool ( E::add, 1, p_.scalar ( 1.0f ) );
+        e_.ss ( E::div, 0, 1 );
+    }
+    else if constexpr ( std::is_same_v<Activation, activation::bipolar_rational> ) {
+        e_.ss_pool ( E::mul, 0, p_.scalar ( Activation::alpha ) );
+        e_.ss_pool ( E::max, 0, p_.scalar ( -Activation::clamp ) );
+        e_.ss_pool ( E::min, 0, p_.scalar ( Activation::clamp ) ); // x
+        e_.ps ( E::mov, 1, 0 );
+        e_.ss ( E::mul, 1, 0 ); // x^2
+        e_.ps ( E::mov, 2, 1 ); // p
+        e_.ss_pool ( E::add, 2, p_.scalar ( 378.0f ) );
+        e_.madd ( 2, 1, p_.scalar ( 17'325.0f ) );
+        e_.madd ( 2, 1, p_.scalar ( 135'135.0f ) );
+        e_.ss_pool ( E::mov, 3, p_.scalar ( 28.0f ) ); // q
+        e_.madd ( 3, 1, p_.scalar ( 3'150.0f ) );
+        e_.madd ( 3, 1, p_.scalar ( 62'370.0f ) );
+        e_.madd ( 3, 1, p_.scalar ( 135'135.0f ) );
+        e_.ss ( E::mul, 0, 2 );
+        e_.ss ( E::div, 0, 3 );
+    }
+    else {
+        e_.call ( &Activation::scalar );
+    }
+}
+
+// Network compiled to native code, the weights baked in. The full input chunks of a row are
+// multiplied (4 at a time) with the weights in the pool, the rest of the inputs and the outputs of
+// the earlier neurons one at a time. Two accumulators per neuron, weights that are zero are left
+// out. Falls back to the feed_forward of the network if the jit is not supported, or fails.
+template<int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar>
+class CompiledNeuralNetwork {
+
+    public:
+    using network_type    = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using ibo_type        = typename network_type::ibo_type;
+    using activation_type = Activation;
+
+    static constexpr int NumIns     = network_type::NumIns;
+    static constexpr int NumInsOuts = network_type::NumInsOuts;
+
+    CompiledNeuralNetwork ( CompiledNeuralNetwork && )      = delete;
+    CompiledNeuralNetwork ( CompiledNeuralNetwork const & ) = delete;
+
+    CompiledNeuralNetwork & operator= ( CompiledNeuralNetwork && ) = delete;
+    CompiledNeuralNetwork & operator= ( CompiledNeuralNetwork const & ) = delete;
+
+    explicit CompiledNeuralNetwork ( network_type const & network_ ) noexcept : m_network{ network_ } {
+        if constexpr ( Supported )
+            compile ( );
+    }
+
+    ~CompiledNeuralNetwork ( ) noexcept {
+        if ( m_memory )
+            free_executable ( m_memory, m_size );
+    }
+
+    [[nodiscard]] float const * feed_forward ( float * const ibo_ ) const noexcept {
+        if ( m_function ) {
+            m_function ( ibo_ );
+            return ibo_ + NumInsOuts - NumOutput;
+        }
+        return m_network.feed_forward ( ibo_ );
+    }
+
+    [[nodiscard]] bool compiled ( ) const noexcept { return nullptr != m_function; }
+
+    private:
+    void compile ( ) noexcept {
+        using E = Emitter;
+        try {
+            Pool pool;
+            std::vector<int> vector_weights, scalar_weights; // Pool offsets, -1 for an all-zero chunk or weight.
+            for ( int n = 0, w = 0; n < NumNeurons; w += NumIns + n++ ) {
+                for ( int c = 0; c < NumIns / 4; ++c ) {
+                    float const v[ 4 ]{ m_network[ w + 4 * c ], m_network[ w + 4 * c + 1 ], m_network[ w + 4 * c + 2 ],
+                                        m_network[ w + 4 * c + 3 ] };
+                    vector_weights.push_back ( v[ 0 ] or v[ 1 ] or v[ 2 ] or v[ 3 ] ? pool.vector ( v ) : -1 );
+                }
+                for ( int i = ( NumIns / 4 ) * 4; i < NumIns + n; ++i )
+                    scalar_weights.push_back ( m_network[ w + i ] ? pool.scalar ( m_network[ w + i ] ) : -1 );
+            }
+            // The constants of the activation go into the pool as well, the code is generated twice, the
+            // first time to find the size of the pool.
+            bool const fma = simd::instruction_set ( ) >= simd::InstructionSet::avx2;
+            auto generate  = [ & ] ( Pool & pool_, int const code_offset_ ) {
+                E e ( code_offset_, fma );
+                e.enter ( );
+                auto vw = std::begin ( vector_weights );
+                auto sw = std::begin ( scalar_weights );
+                for ( int n = 0; n < NumNeurons; ++n ) {
+                    e.zero ( 0 );
+                    e.zero ( 2 );
+                    bool vector = false;
+                    for ( int c = 0; c < NumIns / 4; ++c, ++vw ) {
+                        if ( *vw < 0 )
+                            continue;
+                        e.ps_ibo ( E::mov, 1, 16 * c );
+                        e.macc ( vector ? 2 : 0, 1, *vw, true );
+                        vector = not vector;
+                    }
+                    if constexpr ( NumIns >= 4 ) {
+                        e.ps ( E::add, 0, 2 );
+                        e.hsum ( );
+                        e.zero ( 2 );
+                    }
+                    // The output of the previous neuron (still in xmm4) is on the critical path, it goes last.
+                    int const last = NumIns + n - 1;
+                    bool scalar    = false;
+                    for ( int i = ( NumIns / 4 ) * 4; i < last; ++i, ++sw ) {
+                        if ( *sw < 0 )
+                            continue;
+                        e.ss_ibo ( E::mov, 1, 4 * i );
+                        e.macc ( scalar ? 2 : 0, 1, *sw );
+                        scalar = not scalar;
+                    }
+                    e.ss ( E::add, 0, 2 );
+                    if ( last >= ( NumIns / 4 ) * 4 and *sw++ >= 0 ) {
+                        if ( not n )
+                            e.ss_ibo ( E::mov, 4, 4 * last );
+                        e.macc ( 0, 4, *( sw - 1 ) );
+                    }
+                    activation<activation_type> ( e, pool_ );
+                    e.ss_ibo ( E::store, 0, 4 * ( NumIns + n ) );
+                    e.ps ( E::mov, 4, 0 );
+                }
+                e.leave ( );
+                return e.code ( );
+            };
+            Pool sizing = pool;
+            ( void ) generate ( sizing, 0 );
+            int const code_offset = static_cast<int> ( ( sizeof ( float ) * sizing.data ( ).size ( ) + 63 ) & ~std::size_t{ 63 } );
+            std::vector<std::uint8_t> const code = generate ( pool, code_offset );
+            m_size                               = code_offset + code.size ( );
+            m_memory                             = allocate_executable ( m_size );
+            if ( not m_memory )
+                return;
+            std::memcpy ( m_memory, pool.data ( ).data ( ), sizeof ( float ) * pool.data ( ).size ( ) );
+            std::memcpy ( static_cast<std::uint8_t *> ( m_memory ) + code_offset, code.data ( ), code.size ( ) );
+            if ( protect_executable ( m_memory, m_size ) )
+                m_function = reinterpret_cast<void ( * ) ( float * )> ( static_cast<std::uint8_t *> ( m_memory ) + code_offset );
+        }
+        catch ( ... ) {
+            m_function = nullptr;
+        }
+    }
+
+    network_type m_network;
+    void * m_memory                  = nullptr;
+    std::size_t m_size               = 0;
+    void ( *m_function ) ( float * ) = nullptr;
+};
+
+} // namespace jit
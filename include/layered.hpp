@@ -0,0 +1,163 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <mkl.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <sax/iostream.hpp>
+#include <utility>
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/array.hpp>
+
+#include "activation.hpp"
+#include "dispatch.hpp"
+#include "fcc.hpp"
+#include "rng.hpp"
+#include "simd.hpp"
+
+// The widths of the hidden layers of a LayeredNeuralNetwork.
+template<int... Widths>
+using Hidden = std::integer_sequence<int, Widths...>;
+
+template<int NumInput, typename Hidden, int NumOutput, typename Activation = activation::bipolar>
+struct LayeredNeuralNetwork;
+
+// A feed-forward network of dense layers, the hidden ones (Hidden) plus the output layer, every layer
+// fed by the layer before it only. Its cost is linear in the number of neurons (for a fixed width),
+// and all neurons of a layer are independent, a GEMV per layer. It has the work area (the outputs of
+// the layers, one after the other, the outputs of the network last), the interface and the
+// serialization of FullyConnectedNeuralNetwork, so it plays and evolves the same way. The first layer
+// gets the bias from the work area, the later ones have a bias weight of their own, at the end of
+// their rows.
+template<int NumInput, int... HiddenWidths, int NumOutput, typename Activation>
+struct LayeredNeuralNetwork<NumInput, Hidden<HiddenWidths...>, NumOutput, Activation> {
+
+    static constexpr int NumLayers = sizeof...( HiddenWidths ) + 1;
+
+    static constexpr std::array<int, NumLayers> Widths{ HiddenWidths..., NumOutput };
+
+    static constexpr int NumBias    = 1;
+    static constexpr int NumIns     = NumInput + NumBias;
+    static constexpr int NumNeurons = ( HiddenWidths + ... + NumOutput );
+    static constexpr int NumInsOuts = NumIns + NumNeurons;
+
+    // The offset in the work area of the first input of layer l_, its number of inputs (the bias
+    // excluded for all but the first layer) and the offset of its first weight.
+    [[nodiscard]] static constexpr int layer_num_in ( int l_ ) noexcept { return l_ ? Widths[ l_ - 1 ] : NumIns; }
+    [[nodiscard]] static constexpr int layer_in ( int l_ ) noexcept {
+        return l_ ? layer_in ( l_ - 1 ) + layer_num_in ( l_ - 1 ) : 0;
+    }
+    [[nodiscard]] static constexpr int layer_stride ( int l_ ) noexcept { return layer_num_in ( l_ ) + ( l_ > 0 ); }
+    [[nodiscard]] static constexpr int layer_wgt ( int l_ ) noexcept {
+        return l_ ? layer_wgt ( l_ - 1 ) + Widths[ l_ - 1 ] * layer_stride ( l_ - 1 ) : 0;
+    }
+
+    static constexpr int NumWeights = layer_wgt ( NumLayers );
+
+    using ibo_type        = InputBiasOutput<NumInput, NumNeurons, NumOutput>;
+    using wgt_type        = std::array<float, NumWeights>;
+    using activation_type = Activation;
+
+    using pointer        = typename wgt_type::pointer;
+    using const_pointer  = typename wgt_type::const_pointer;
+    using iterator       = typename wgt_type::iterator;
+    using const_iterator = typename wgt_type::const_iterator;
+
+    LayeredNeuralNetwork ( ) noexcept {
+        std::generate ( std::begin ( m_weights ), std::end ( m_weights ),
+                        [] ( ) noexcept { return std::uniform_real_distribution<float> ( -1.0f, 1.0f ) ( Rng::gen ( ) ); } );
+    }
+
+    // The backend used by feed_forward, shared by all networks of this type.
+    static inline Backend backend = Backend::simd;
+
+    [[nodiscard]] const_pointer feed_forward ( pointer const ibo_ ) const noexcept {
+        switch ( backend ) {
+            case Backend::mkl: return feed_forward_mkl ( ibo_ );
+            case Backend::simd: return feed_forward_simd ( ibo_ );
+        }
+        return feed_forward_simd ( ibo_ );
+    }
+
+    // One cblas_sgemv per layer, the biases are copied into the outputs first.
+    [[nodiscard]] const_pointer feed_forward_mkl ( pointer const ibo_ ) const noexcept {
+        for ( int l = 0; l < NumLayers; ++l ) {
+            int const num_in      = layer_num_in ( l );
+            int const stride      = layer_stride ( l );
+            const_pointer const w = m_weights.data ( ) + layer_wgt ( l );
+            const_pointer const x = ibo_ + layer_in ( l );
+            pointer const out     = ibo_ + layer_in ( l ) + num_in;
+            if ( l )
+                cblas_scopy ( Widths[ l ], w + num_in, stride, out, 1 );
+            cblas_sgemv ( CblasRowMajor, CblasNoTrans, Widths[ l ], num_in, 1.0f, w, stride, x, 1, l ? 1.0f : 0.0f, out, 1 );
+            for ( int n = 0; n < Widths[ l ]; ++n )
+                out[ n ] = Activation::scalar ( out[ n ] );
+        }
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    // The layers by simd::dense, blocked GEMV's, no library calls.
+    [[nodiscard]] const_pointer feed_forward_simd ( pointer const ibo_ ) const noexcept {
+        simd::dispatched<simd::Layered<Activation, NumIns, HiddenWidths..., NumOutput>> ( ibo_, m_weights.data ( ) );
+        return ibo_ + NumInsOuts - NumOutput;
+    }
+
+    template<typename Stream>
+    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, LayeredNeuralNetwork const & w_ ) noexcept {
+        for ( auto const v : w_.m_weights )
+            out_ << v << ' ';
+        out_ << nl;
+        return out_;
+    }
+
+    [[nodiscard]] float & operator[] ( int i_ ) noexcept { return m_weights[ i_ ]; }
+    [[nodiscard]] float const & operator[] ( int i_ ) const noexcept { return m_weights[ i_ ]; }
+
+    [[nodiscard]] constexpr pointer data ( ) noexcept { return m_weights.data ( ); }
+    [[nodiscard]] constexpr const_pointer data ( ) const noexcept { return m_weights.data ( ); }
+
+    [[nodiscard]] iterator begin ( ) noexcept { return iterator ( m_weights.begin ( ) ); }
+    [[nodiscard]] iterator end ( ) noexcept { return iterator ( m_weights.end ( ) ); }
+    [[nodiscard]] const_iterator begin ( ) const noexcept { return const_iterator ( m_weights.begin ( ) ); }
+    [[nodiscard]] const_iterator cbegin ( ) const noexcept { return const_iterator ( m_weights.cbegin ( ) ); }
+    [[nodiscard]] const_iterator end ( ) const noexcept { return const_iterator ( m_weights.end ( ) ); }
+    [[nodiscard]] const_iterator cend ( ) const noexcept { return const_iterator ( m_weights.cend ( ) ); }
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void serialize ( Archive & ar_ ) {
+        ar_ ( m_weights );
+    }
+
+    alignas ( 64 ) wgt_type m_weights;
+};
@@ -32,21 +32,35 @@
 #include <execution>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <numeric>
 #include <random>
 #include <sax/iostream.hpp>
 #include <span>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 #include <sax/uniform_int_distribution.hpp>
 
 #include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
 
 #include "fcc.hpp"
+#include "fcc_half.hpp"
+#include "fcc_incremental.hpp"
+#include "fcc_padded.hpp"
+#include "fcc_quantized.hpp"
+#include "fcc_sparse.hpp"
+#include "export.hpp"
+#include "fcc_split.hpp"
 #include "globals.hpp"
+#include "jit.hpp"
+#include "layered.hpp"
 #include "rng.hpp"
 #include "snake.hpp"
+#include "snake_batch.hpp"
 #include "uniformly_decreasing_discrete_distribution_vose.hpp"
 
 #include <plf_nanotimer.h>
@@ -92,13 +106,108 @@ struct Config final {
     static constexpr char const s_name[]{ "config" };
 };
 
-template<int PopSize, int FieldSize, int NumInput, int NumNeurons, int NumOutput>
+// The inference variant picked by Population::tune, with the cpu and the topology (the template
+// parameters of the population) it was timed on, and the version of the list of variants it was
+// picked from (bump Version when the variants change, a file of another version is retuned).
+struct TuningParams {
+
+    static constexpr int Version = 2;
+
+    std::string cpu;
+    std::string topology;
+    int evaluation;
+    int backend;
+    int version = 0; // 0 is from before the version was kept.
+
+    private:
+    friend class cereal::access;
+
+    template<class Archive>
+    void serialize ( Archive & ar_ ) {
+        ar_ ( CEREAL_NVP ( cpu ) );
+        ar_ ( CEREAL_NVP ( topology ) );
+        ar_ ( CEREAL_NVP ( evaluation ) );
+        ar_ ( CEREAL_NVP ( backend ) );
+        try {
+            ar_ ( CEREAL_NVP ( version ) );
+        }
+        catch ( cereal::Exception const & ) { // The file has no version.
+            version = 0;
+        }
+    }
+};
+
+// How the individuals are played.
+enum class Evaluation : int {
+    serial,      // one individual (and network) at a time.
+    interleaved, // a batch of individuals in lockstep, one network per vector lane.
+    lockstep,    // one individual at a time, its episodes in lockstep, one episode per vector lane.
+    split,       // one individual at a time, by a mirror of its network split for wide networks (input GEMV, triangular pass).
+    incremental, // one individual at a time, by a mirror of its network that only applies the inputs that changed.
+    sparse,      // one individual at a time, by a mirror of its network with its live (non-zero) connections only.
+    batched,     // a batch of individuals, as interleaved, the snakes of all lanes in one SnakeBatch (structure of arrays).
+    scheduled    // the individuals as coroutines, one per lane, a lane takes the next individual as soon as its run ends.
+};
+
+[[nodiscard]] inline wchar_t const * evaluation_name ( Evaluation e_ ) noexcept {
+    switch ( e_ ) {
+        case Evaluation::serial: return L"serial";
+        case Evaluation::interleaved: return L"interleaved";
+        case Evaluation::lockstep: return L"lockstep";
+        case Evaluation::split: return L"split";
+        case Evaluation::incremental: return L"incremental";
+        case Evaluation::sparse: return L"sparse";
+        case Evaluation::batched: return L"batched";
+        case Evaluation::scheduled: return L"scheduled";
+    }
+    return L"";
+}
+
+// The genomes (weights) are stored as Weight, float, simd::fp16 or simd::bf16. The brains are cascades,
+// unless Network is given, any network with the work area (and interface) of a cascade of NumNeurons
+// neurons, e.g. a LayeredNeuralNetwork, it's then evaluated serially (the other evaluations need the
+// layout of a cascade).
+template<int PopSize, int FieldSize, int NumInput, int NumNeurons, int NumOutput, typename Activation = activation::bipolar,
+         typename Weight = float, typename Network = void>
 struct Population {
 
     static constexpr int BreedSize = PopSize / 3;
 
-    using TheBrain   = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput>;
-    using SnakeSpace = SnakeSpace<FieldSize, NumInput, NumNeurons, NumOutput>;
+    static constexpr bool IsCascade = std::is_void_v<Network>;
+
+    using TheCascade     = std::conditional_t<std::is_same_v<Weight, float>,
+                                          FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>,
+                                          HalfNeuralNetwork<NumInput, NumNeurons, NumOutput, Weight, Activation>>;
+    using TheBrain       = std::conditional_t<IsCascade, TheCascade, Network>;
+    using TheBrainBatch  = InterleavedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using TheBrainPadded = PaddedNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using TheBrainInt16  = QuantizedNeuralNetwork<NumInput, NumNeurons, NumOutput, std::int16_t, Activation>;
+    using TheBrainInt8   = QuantizedNeuralNetwork<NumInput, NumNeurons, NumOutput, std::int8_t, Activation>;
+    using TheBrainSplit  = SplitNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using TheBrainIncr   = IncrementalNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using TheBrainSparse = SparseNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using TheBrainJit    = jit::CompiledNeuralNetwork<NumInput, NumNeurons, NumOutput, Activation>;
+    using SnakeSpace     = SnakeSpace<FieldSize, NumInput, NumNeurons, NumOutput>;
+    using SnakeBatch     = SnakeBatch<FieldSize, NumInput, NumNeurons, NumOutput>;
+
+    static constexpr int NumLanes = TheBrainBatch::NumLanes;
+    // The number of individuals the variants are timed on.
+    static constexpr int NumTuneIndividuals = PopSize < 1'024 ? PopSize : 1'024;
+    // Only the float genomes have a choice of backend.
+    static constexpr bool HasBackend = requires { TheBrain::backend; };
+
+    // The inference variants tune picks from, see tune.
+    static constexpr std::pair<Evaluation, Backend> TuneVariants[] = { { Evaluation::serial, Backend::simd },
+                                                                       { Evaluation::serial, Backend::mkl },
+                                                                       { Evaluation::interleaved, Backend::simd },
+                                                                       { Evaluation::split, Backend::simd },
+                                                                       { Evaluation::incremental, Backend::simd },
+                                                                       { Evaluation::sparse, Backend::simd },
+                                                                       { Evaluation::batched, Backend::simd },
+                                                                       { Evaluation::scheduled, Backend::simd } };
+
+    static_assert ( std::is_same_v<typename TheBrain::ibo_type, InputBiasOutput<NumInput, NumNeurons, NumOutput>>,
+                    "the brain should have the work area of a cascade of NumNeurons neurons" );
 
     // This is a 'dumb' object, no memory is managed, but memory is
     // created on a load iff required.
@@ -150,6 +259,7 @@ struct Population {
                                     i.id = new TheBrain ( );
                             } );
         }
+        tune ( );
     }
 
     ~Population ( ) noexcept {
@@ -160,14 +270,10 @@ struct Population {
                         } );
     }
 
+    using iterator = typename std::vector<Individual>::iterator;
+
     void evaluate ( ) noexcept {
-        static thread_local SnakeSpace snake_space;
-        std::for_each (
-            std::execution::par_unseq, std::begin ( m_population ), std::end ( m_population ), [] ( Individual & i ) noexcept {
-                ++i.age;
-                i.fitness +=
-                    ( ( snake_space.run ( i.id, i.age ) - i.fitness ) / static_cast<float> ( i.age ) ); // Maintain the average.
-            } );
+        evaluate ( std::begin ( m_population ), std::end ( m_population ) );
 
         std::sort ( std::execution::par_unseq, std::begin ( m_population ), std::end ( m_population ),
                     [] ( Individual const & a, Individual const & b ) noexcept { return a.fitness > b.fitness; } );
@@ -176,17 +282,248 @@ struct Population {
         // std::wcout << nl << nl;
     }
 
+    void evaluate ( iterator const b_, iterator const e_ ) noexcept {
+        if constexpr ( IsCascade ) {
+            switch ( m_quantization ) {
+                case Quantization::none:
+                    switch ( m_evaluation ) {
+                        case Evaluation::serial: evaluate_serial ( b_, e_ ); break;
+                        case Evaluation::interleaved: evaluate_interleaved ( b_, e_ ); break;
+                        case Evaluation::lockstep: evaluate_lockstep ( b_, e_ ); break;
+                        case Evaluation::split: evaluate_mirrored<TheBrainSplit> ( b_, e_ ); break;
+                        case Evaluation::incremental: evaluate_mirrored<TheBrainIncr> ( b_, e_ ); break;
+                        case Evaluation::sparse: evaluate_mirrored<TheBrainSparse> ( b_, e_ ); break;
+                        case Evaluation::batched: evaluate_batched ( b_, e_ ); break;
+                        case Evaluation::scheduled: evaluate_scheduled ( b_, e_ ); break;
+                    }
+                    break;
+                case Quantization::int16:
+                    if constexpr ( TheBrainInt16::Supported )
+                        evaluate_mirrored<TheBrainInt16> ( b_, e_ );
+                    break;
+                case Quantization::int8:
+                    if constexpr ( TheBrainInt8::Supported )
+                        evaluate_mirrored<TheBrainInt8> ( b_, e_ );
+                    break;
+            }
+        }
+        else {
+            evaluate_serial ( b_, e_ );
+        }
+    }
+
+    void evaluate_serial ( iterator const b_, iterator const e_ ) noexcept {
+        static thread_local SnakeSpace snake_space;
+        std::for_each ( std::execution::par_unseq, b_, e_, [] ( Individual & i ) noexcept {
+            ++i.age;
+            add_fitness ( i, snake_space.run ( i.id, i.age ) );
+        } );
+    }
+
+    void evaluate_interleaved ( iterator const b_, iterator const e_ ) noexcept {
+        int const num_batches = static_cast<int> ( ( e_ - b_ ) / NumLanes );
+        std::vector<int> batches ( num_batches );
+        std::iota ( std::begin ( batches ), std::end ( batches ), 0 );
+        std::for_each ( std::execution::par_unseq, std::begin ( batches ), std::end ( batches ), [ b_ ] ( int const b ) noexcept {
+            static thread_local TheBrainBatch brain;
+            static thread_local std::array<SnakeSpace, NumLanes> snake_spaces;
+            Individual * const batch = &*b_ + b * NumLanes;
+            for ( int l = 0; l < NumLanes; ++l )
+                brain.assign ( l, *batch[ l ].id );
+            float fitness[ NumLanes ];
+            SnakeSpace::run_interleaved ( brain, snake_spaces.data ( ), fitness );
+            for ( int l = 0; l < NumLanes; ++l ) {
+                ++batch[ l ].age;
+                add_fitness ( batch[ l ], fitness[ l ] );
+            }
+        } );
+        // The ones that don't fill a batch.
+        evaluate_serial ( b_ + num_batches * NumLanes, e_ );
+    }
+
+    void evaluate_batched ( iterator const b_, iterator const e_ ) noexcept {
+        int const num_batches = static_cast<int> ( ( e_ - b_ ) / NumLanes );
+        std::vector<int> batches ( num_batches );
+        std::iota ( std::begin ( batches ), std::end ( batches ), 0 );
+        std::for_each ( std::execution::par_unseq, std::begin ( batches ), std::end ( batches ), [ b_ ] ( int const b ) noexcept {
+            static thread_local TheBrainBatch brain;
+            static thread_local SnakeBatch snake_batch;
+            Individual * const batch = &*b_ + b * NumLanes;
+            for ( int l = 0; l < NumLanes; ++l )
+                brain.assign ( l, *batch[ l ].id );
+            float fitness[ NumLanes ];
+            snake_batch.run ( brain, fitness );
+            for ( int l = 0; l < NumLanes; ++l ) {
+                ++batch[ l ].age;
+                add_fitness ( batch[ l ], fitness[ l ] );
+            }
+        } );
+        // The ones that don't fill a batch.
+        evaluate_serial ( b_ + num_batches * NumLanes, e_ );
+    }
+
+    // The individuals are played in chunks, a chunk by the scheduler of a thread, NumLanes runs at a time,
+    // all suspended runs share one feed-forward of the batch brain. A chunk is a number of batches, the
+    // lanes only run empty at its end.
+    void evaluate_scheduled ( iterator const b_, iterator const e_ ) noexcept {
+        static constexpr int ChunkSize = 8 * NumLanes;
+        int const num_individuals = static_cast<int> ( e_ - b_ );
+        std::vector<int> chunks ( ( num_individuals + ChunkSize - 1 ) / ChunkSize );
+        std::iota ( std::begin ( chunks ), std::end ( chunks ), 0 );
+        std::for_each ( std::execution::par_unseq, std::begin ( chunks ), std::end ( chunks ),
+                        [ b_, num_individuals ] ( int const c ) noexcept {
+                            static thread_local TheBrainBatch brain;
+                            static thread_local typename TheBrainBatch::ibo_type work_area;
+                            static thread_local std::array<SnakeSpace, NumLanes> snake_spaces;
+                            Individual * const chunk = &*b_ + c * ChunkSize;
+                            schedule<NumLanes> (
+                                std::min ( ChunkSize, num_individuals - c * ChunkSize ),
+                                [ & ] ( int const l, int const i ) noexcept {
+                                    brain.assign ( l, *chunk[ i ].id );
+                                    return snake_spaces[ l ].run_scheduled ( work_area, l );
+                                },
+                                [ & ] ( ) noexcept { brain.feed_forward ( work_area ); },
+                                [ & ] ( int const i, float const f ) noexcept {
+                                    ++chunk[ i ].age;
+                                    add_fitness ( chunk[ i ], f );
+                                } );
+                        } );
+    }
+
+    void evaluate_lockstep ( iterator const b_, iterator const e_ ) noexcept {
+        std::for_each ( std::execution::par_unseq, b_, e_, [] ( Individual & i ) noexcept {
+            static thread_local std::array<SnakeSpace, NumLanes> snake_spaces;
+            ++i.age;
+            add_fitness ( i, SnakeSpace::template run_lockstep<NumLanes> ( i.id, snake_spaces.data ( ) ) );
+        } );
+    }
+
+    // The mirror (quantized, split, incremental, sparse) of a brain is made from its weights just before it plays, it's only
+    // used for the evaluation of the fitness.
+    template<typename MirrorBrain>
+    void evaluate_mirrored ( iterator const b_, iterator const e_ ) noexcept {
+        std::for_each ( std::execution::par_unseq, b_, e_, [] ( Individual & i ) noexcept {
+            static thread_local SnakeSpace snake_space;
+            static thread_local MirrorBrain brain;
+            brain.assign ( *i.id );
+            ++i.age;
+            add_fitness ( i, snake_space.run ( &brain, i.age ) );
+        } );
+    }
+
+    void evaluation ( Evaluation const e_ ) noexcept { m_evaluation = e_; }
+
+    // Evaluate with quantized brains (the evaluation mode is then ignored), or not (none). Networks that
+    // are too wide for the integer dot products stay unquantized.
+    void quantization ( Quantization const q_ ) noexcept {
+        if ( Quantization::none != q_ and not TheBrainInt16::Supported ) {
+            std::wcout << L" quantization " << quantization_name ( q_ ) << L" is not supported for this topology" << nl;
+            return;
+        }
+        m_quantization = q_;
+    }
+
+    // Prune the connections of the breeders with a weight below threshold_ (in absolute value) after each
+    // evaluation, and let the mutation switch connections on and off, or not (0, the default).
+    void pruning ( float const threshold_ ) noexcept { m_prune_threshold = threshold_; }
+
+    // Memoize the decisions of the brains (per brain, on their quantized observations), or not (the default).
+    void memoization ( bool const m_ ) noexcept {
+        SnakeSpace::memoize = m_;
+        SnakeSpace::Cache::reset ( );
+    }
+
+    // End the episodes of circling snakes as soon as their state repeats, or not (the default).
+    void cycle_detection ( bool const d_ ) noexcept {
+        SnakeSpace::detect_cycles = d_;
+        SnakeSpace::Cycles::reset ( );
+    }
+
+    // Picks the fastest inference variant (evaluation and backend) for this topology on this cpu, by
+    // timing the evaluation of a sample of the population with each of them. The choice is saved next
+    // to the population, later starts read it back, unless the cpu or the template parameters changed.
+    // The variants all play NumEpisodes episodes per individual, lockstep plays NumLanes of them (a
+    // fitness of less noise, another selection pressure), it's not a variant, it's only set explicitly.
+    void tune ( ) {
+        TuningParams params{ simd::cpu_name ( ) + ' ' + narrow ( simd::name ( simd::instruction_set ( ) ) ), topology ( ), 0, 0,
+                             TuningParams::Version };
+        if ( fs::exists ( s_tuning_file ) ) {
+            TuningParams saved;
+            load_from_file_json ( s_tuning_name, saved, s_tuning_file );
+            if ( saved.cpu == params.cpu and saved.topology == params.topology and tunable ( saved ) ) {
+                variant ( static_cast<Evaluation> ( saved.evaluation ), static_cast<Backend> ( saved.backend ) );
+                return;
+            }
+        }
+        constexpr int NumRepeats = 3;
+        std::vector<Individual> sample ( NumTuneIndividuals );
+        double best = std::numeric_limits<double>::max ( );
+        for ( auto const & [ e, b ] : TuneVariants ) {
+            if ( not tunable ( e, b ) )
+                continue;
+            variant ( e, b );
+            double elapsed = std::numeric_limits<double>::max ( );
+            for ( int r = 0; r < NumRepeats; ++r ) {
+                std::copy_n ( std::begin ( m_population ), NumTuneIndividuals, std::begin ( sample ) );
+                plf::nanotimer timer;
+                timer.start ( );
+                evaluate ( std::begin ( sample ), std::end ( sample ) );
+                elapsed = std::min ( elapsed, timer.get_elapsed_ns ( ) );
+            }
+            std::wcout << L" tune " << std::setw ( 11 ) << evaluation_name ( e ) << L" " << std::setw ( 4 ) << backend_name ( b )
+                       << L" " << std::setprecision ( 2 ) << std::fixed << std::setw ( 9 )
+                       << ( elapsed / ( 1'000.0 * NumTuneIndividuals ) ) << L" us/individual" << nl;
+            if ( elapsed < best ) {
+                best              = elapsed;
+                params.evaluation = static_cast<int> ( e );
+                params.backend    = static_cast<int> ( b );
+            }
+        }
+        variant ( static_cast<Evaluation> ( params.evaluation ), static_cast<Backend> ( params.backend ) );
+        save_to_file_json ( s_tuning_name, params, s_tuning_file );
+    }
+
+    // With pruning, a pruned (zero) connection stays pruned, unless the mutation switches it on again,
+    // one in NumToggle mutations switches a connection on or off.
     void mutate ( TheBrain * const c_ ) noexcept {
+        constexpr int NumToggle = 8;
         static uniformly_decreasing_discrete_distribution<4> dddis;
         // static std::piecewise_linear_distribution<float> tridis = triangular_distribution ( );
         int rep = dddis ( Rng::gen ( ) );
         do {
             int const mup = std::uniform_int_distribution<int> ( 0, TheBrain::NumWeights - 1 ) ( Rng::gen ( ) ); // mutation point.
+            if ( m_prune_threshold > 0.0f ) {
+                bool const live = 0.0f != ( *c_ )[ mup ];
+                if ( 0 == std::uniform_int_distribution<int> ( 0, NumToggle - 1 ) ( Rng::gen ( ) ) )
+                    ( *c_ )[ mup ] = live ? 0.0f : std::normal_distribution<float> ( 0.0f, 2.0f ) ( Rng::gen ( ) );
+                else if ( live )
+                    ( *c_ )[ mup ] += std::normal_distribution<float> ( 0.0f, 2.0f ) ( Rng::gen ( ) );
+                continue;
+            }
             ( *c_ )[ mup ] += std::normal_distribution<float> ( 0.0f, 2.0f ) ( Rng::gen ( ) );
             // ( *c_ )[ mup ] += tridis ( Rng::gen ( ) );
         } while ( rep-- );
     }
 
+    // Zero the weights of the breeders below the prune threshold, their offspring inherits the pruned connections.
+    void prune ( ) noexcept {
+        std::for_each ( std::execution::par_unseq, std::begin ( m_population ), std::begin ( m_population ) + BreedSize,
+                        [ this ] ( Individual & i ) noexcept {
+                            for ( int w = 0; w < TheBrain::NumWeights; ++w )
+                                if ( std::abs ( ( *i.id )[ w ] ) < m_prune_threshold )
+                                    ( *i.id )[ w ] = 0.0f;
+                        } );
+    }
+
+    // The number of live (non-zero) connections of the champion.
+    [[nodiscard]] int num_connections ( ) const noexcept {
+        TheBrain const & champion = *m_population[ 0 ].id;
+        int n                     = 0;
+        for ( int w = 0; w < TheBrain::NumWeights; ++w )
+            n += 0.0f != champion[ w ];
+        return n;
+    }
+
     void reproduce ( ) noexcept {
         std::for_each ( std::execution::par_unseq, std::begin ( m_population ) + BreedSize, std::end ( m_population ),
                         [this] ( Individual & i ) noexcept {
@@ -206,10 +543,17 @@ struct Population {
         return { *m_population[ p0 ].id, *m_population[ p1 ].id };
     }
 
+    // The champion plays, compiled (if it's a cascade with float weights).
     void display ( ) const noexcept {
         cls ( );
         SnakeSpace snake_space;
-        snake_space.run_display ( m_population[ 0 ].id );
+        if constexpr ( IsCascade and HasBackend ) {
+            TheBrainJit champion ( *m_population[ 0 ].id );
+            snake_space.run_display ( &champion );
+        }
+        else {
+            snake_space.run_display ( m_population[ 0 ].id );
+        }
     }
 
     void print_statistics ( ) const noexcept {
@@ -217,13 +561,30 @@ struct Population {
         float const aa = average_age ( );
         std::wcout << L" generation " << std::setw ( 6 ) << m_generation << L" fitness " << std::setprecision ( 2 ) << std::fixed
                    << std::setw ( 7 ) << m_population[ 0 ].fitness << L" " << m_population[ 0 ].age << L" (" << std::setw ( 7 )
-                   << af << L" " << aa << L")" << nl;
+                   << af << L" " << aa << L") " << simd::name ( simd::instruction_set ( ) );
+        if ( m_prune_threshold > 0.0f )
+            std::wcout << L" connections " << num_connections ( ) << L"/" << TheBrain::NumWeights;
+        // The share of the decisions (of the serial evaluations) taken by the cache, the feed-forwards saved.
+        if ( SnakeSpace::memoize and SnakeSpace::Cache::lookups ( ) ) {
+            std::wcout << L" memo " << std::setprecision ( 1 )
+                       << ( 100.0 * SnakeSpace::Cache::hits ( ) / SnakeSpace::Cache::lookups ( ) ) << L"% "
+                       << SnakeSpace::Cache::hits ( ) << L" saved";
+            SnakeSpace::Cache::reset ( );
+        }
+        // The episodes ended on a cycle, and the steps that saved.
+        if ( SnakeSpace::detect_cycles ) {
+            std::wcout << L" cycles " << SnakeSpace::Cycles::cycles ( ) << L" " << SnakeSpace::Cycles::steps ( ) << L" steps saved";
+            SnakeSpace::Cycles::reset ( );
+        }
+        std::wcout << nl;
     }
 
     void run ( ) noexcept {
         static ConfigParams const & config = Config::instance ( );
         while ( true ) {
             evaluate ( );
+            if ( m_prune_threshold > 0.0f )
+                prune ( );
             reproduce ( );
             ++m_generation;
             Config::load ( );
@@ -235,6 +596,235 @@ struct Population {
         }
     }
 
+    // Compares the feed-forward backends (with float weights, or else the half precision kernel) on the
+    // brains of this population, and the padded and split layouts (on copies of the brains).
+    void benchmark_feed_forward ( ) const noexcept {
+        constexpr int NumRepeats = 64;
+        typename TheBrain::ibo_type work_area;
+        for ( float & v : work_area.input ( ) )
+            v = std::uniform_real_distribution<float> ( -1.0f, 1.0f ) ( Rng::gen ( ) );
+        auto report = [] ( wchar_t const * name_, double const elapsed_ ) noexcept {
+            std::wcout << L" backend " << std::setw ( 6 ) << name_ << L" " << std::setprecision ( 2 ) << std::fixed
+                       << std::setw ( 10 ) << ( 1'000.0 * NumRepeats * PopSize / elapsed_ ) << L" M feed-forwards/sec" << nl;
+        };
+        auto run = [ this, &work_area ] ( ) noexcept {
+            plf::nanotimer timer;
+            timer.start ( );
+            for ( int r = 0; r < NumRepeats; ++r )
+                for ( Individual const & i : m_population )
+                    ( void ) i.id->feed_forward ( work_area.data ( ) );
+            return timer.get_elapsed_ns ( );
+        };
+        if constexpr ( std::is_same_v<Weight, float> ) {
+            Backend const backend = TheBrain::backend;
+            for ( Backend const b : { Backend::mkl, Backend::simd } ) {
+                TheBrain::backend = b;
+                report ( backend_name ( b ), run ( ) );
+            }
+            TheBrain::backend = backend;
+        }
+        else {
+            report ( weight_name ( Weight{ } ), run ( ) );
+        }
+        // The mirrors of the (first) brains, as many as fit in 256MB, the time is scaled to PopSize.
+        auto run_mirror = [ this, &work_area, &report ] ( auto type_, wchar_t const * name_ ) noexcept {
+            using Mirror         = typename decltype ( type_ )::type;
+            int const num_copies = static_cast<int> ( std::clamp<std::size_t> ( ( 1u << 28 ) / sizeof ( Mirror ), 1, PopSize ) );
+            std::vector<Mirror> mirrors ( num_copies );
+            for ( int i = 0; i < num_copies; ++i )
+                mirrors[ i ].assign ( *m_population[ i ].id );
+            typename Mirror::ibo_type mirror_work_area;
+            std::copy ( std::begin ( work_area.input ( ) ), std::end ( work_area.input ( ) ),
+                        std::begin ( mirror_work_area.input ( ) ) );
+            plf::nanotimer timer;
+            timer.start ( );
+            for ( int r = 0; r < NumRepeats; ++r )
+                for ( Mirror const & brain : mirrors )
+                    ( void ) brain.feed_forward ( mirror_work_area.data ( ) );
+            report ( name_, timer.get_elapsed_ns ( ) * PopSize / num_copies );
+        };
+        if constexpr ( IsCascade ) {
+            run_mirror ( std::type_identity<TheBrainPadded>{ }, L"padded" );
+            run_mirror ( std::type_identity<TheBrainSplit>{ }, L"split" );
+        }
+        // The compiled brains, the (first) NumTuneIndividuals, each one has its own code pages.
+        if constexpr ( IsCascade and HasBackend ) {
+            std::vector<std::unique_ptr<TheBrainJit>> compiled;
+            for ( int i = 0; i < NumTuneIndividuals; ++i )
+                compiled.push_back ( std::make_unique<TheBrainJit> ( *m_population[ i ].id ) );
+            typename TheBrainJit::ibo_type jit_work_area = work_area;
+            plf::nanotimer timer;
+            timer.start ( );
+            for ( int r = 0; r < NumRepeats; ++r )
+                for ( std::unique_ptr<TheBrainJit> const & brain : compiled )
+                    ( void ) brain->feed_forward ( jit_work_area.data ( ) );
+            report ( compiled[ 0 ]->compiled ( ) ? L"jit" : L"nojit", timer.get_elapsed_ns ( ) * PopSize / NumTuneIndividuals );
+        }
+    }
+
+    // Compares the activation policies on the breeders of this population, steps/sec and the drift of
+    // the fitness relative to the exact bipolar sigmoid. The episodes of each individual are replayed
+    // with the same seed for every policy.
+    void benchmark_activation ( ) const noexcept {
+        static_assert ( IsCascade, "the policies are compared on cascades" );
+        std::vector<float> reference;
+        auto benchmark = [ this, &reference ] ( auto policy_ ) noexcept {
+            using Brain = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput, decltype ( policy_ )>;
+            static Brain brain;
+            static SnakeSpace snake_space;
+            std::vector<float> fitness ( BreedSize );
+            std::int64_t const num_moves = snake_space.m_num_moves;
+            plf::nanotimer timer;
+            timer.start ( );
+            for ( int i = 0; i < BreedSize; ++i ) {
+                for ( int w = 0; w < TheBrain::NumWeights; ++w )
+                    brain[ w ] = ( *m_population[ i ].id )[ w ];
+                Rng::seed ( i + 1 );
+                fitness[ i ] = snake_space.run ( &brain, 0 );
+            }
+            double const elapsed = timer.get_elapsed_ns ( );
+            if ( reference.empty ( ) )
+                reference = fitness;
+            float af = 0.0f, drift = 0.0f;
+            for ( int i = 0; i < BreedSize; ++i ) {
+                af += fitness[ i ];
+                drift += std::abs ( fitness[ i ] - reference[ i ] );
+            }
+            std::wcout << L" activation " << std::setw ( 16 ) << activation::name ( policy_ ) << L" " << std::setprecision ( 2 )
+                       << std::fixed << std::setw ( 8 ) << ( 1'000.0 * ( snake_space.m_num_moves - num_moves ) / elapsed )
+                       << L" M steps/sec fitness " << std::setw ( 7 ) << ( af / BreedSize ) << L" drift " << std::setw ( 7 )
+                       << ( drift / BreedSize ) << nl;
+        };
+        benchmark ( activation::bipolar{ } );
+        benchmark ( activation::bipolar_rational{ } );
+        benchmark ( activation::elliotsig{ } );
+        benchmark ( activation::bipolar_clipped{ } );
+        Rng::seed ( );
+    }
+
+    // Reports how much quantization changes the play of the breeders: the share of the decisions of
+    // the fp32 brain the quantized one takes differently (on the same observations), and steps/sec,
+    // fitness and fitness drift of the quantized brain alone, with the episodes replayed from the
+    // same seeds.
+    void benchmark_quantization ( ) const noexcept {
+        static_assert ( IsCascade, "the quantized networks are cascades" );
+        static SnakeSpace snake_space;
+        std::vector<float> reference ( BreedSize );
+        for ( int i = 0; i < BreedSize; ++i ) {
+            Rng::seed ( i + 1 );
+            reference[ i ] = snake_space.run ( m_population[ i ].id, 0 );
+        }
+        auto benchmark = [ this, &reference ] ( auto brain_, wchar_t const * name_ ) noexcept {
+            std::int64_t num_decisions = 0, num_changed = 0;
+            for ( int i = 0; i < BreedSize; ++i ) {
+                brain_.assign ( *m_population[ i ].id );
+                Rng::seed ( i + 1 );
+                ( void ) snake_space.run_compare ( m_population[ i ].id, &brain_, num_decisions, num_changed );
+            }
+            std::vector<float> fitness ( BreedSize );
+            std::int64_t const num_moves = snake_space.m_num_moves;
+            plf::nanotimer timer;
+            timer.start ( );
+            for ( int i = 0; i < BreedSize; ++i ) {
+                brain_.assign ( *m_population[ i ].id );
+                Rng::seed ( i + 1 );
+                fitness[ i ] = snake_space.run ( &brain_, 0 );
+            }
+            double const elapsed = timer.get_elapsed_ns ( );
+            float af = 0.0f, drift = 0.0f;
+            for ( int i = 0; i < BreedSize; ++i ) {
+                af += fitness[ i ];
+                drift += std::abs ( fitness[ i ] - reference[ i ] );
+            }
+            std::wcout << L" quantization " << std::setw ( 5 ) << name_ << L" " << std::setprecision ( 2 ) << std::fixed
+                       << std::setw ( 8 ) << ( 1'000.0 * ( snake_space.m_num_moves - num_moves ) / elapsed )
+                       << L" M steps/sec fitness " << std::setw ( 7 ) << ( af / BreedSize ) << L" drift " << std::setw ( 7 )
+                       << ( drift / BreedSize ) << L" decisions changed " << std::setw ( 6 )
+                       << ( 100.0 * num_changed / num_decisions ) << L"%" << nl;
+        };
+        if constexpr ( TheBrainInt16::Supported ) {
+            benchmark ( TheBrainInt16{ }, quantization_name ( Quantization::int16 ) );
+            benchmark ( TheBrainInt8{ }, quantization_name ( Quantization::int8 ) );
+        }
+        else {
+            std::wcout << L" quantization is not supported for this topology" << nl;
+        }
+        Rng::seed ( );
+    }
+
+    // Writes the champion as a standalone header, z://tmp//<name_>.hpp, see standalone::write.
+    void export_champion ( std::string const & name_ = "champion" ) const {
+        static_assert ( IsCascade, "only cascades are exported" );
+        std::string const comment = "the champion of generation " + std::to_string ( m_generation ) + ", fitness " +
+                                    std::to_string ( m_population[ 0 ].fitness ) + ", " + topology ( );
+        standalone::write_to_file<NumInput, NumNeurons, NumOutput, Activation> ( *m_population[ 0 ].id, "z://tmp", name_,
+                                                                                 comment );
+    }
+
+    // Compares an exported champion (the struct in the header export_champion wrote, compiled in) to
+    // the backends of the in-tree brain with the same weights, on the same inputs, feed-forwards/sec
+    // and the largest difference of the outputs.
+    template<typename Exported>
+    void benchmark_export ( ) const noexcept {
+        static_assert ( IsCascade, "only cascades are exported" );
+        static_assert ( Exported::NumInput == NumInput and Exported::NumNeurons == NumNeurons and Exported::NumOutput == NumOutput,
+                        "the exported network has a different topology" );
+        constexpr int NumInputs = 1'024, NumRepeats = 256;
+        std::vector<typename TheBrain::ibo_type> inputs ( NumInputs );
+        for ( typename TheBrain::ibo_type & ibo : inputs )
+            for ( float & v : ibo.input ( ) )
+                v = std::uniform_real_distribution<float> ( -1.0f, 1.0f ) ( Rng::gen ( ) );
+        std::unique_ptr<TheBrain> brain = std::make_unique<TheBrain> ( );
+        for ( int w = 0; w < TheBrain::NumWeights; ++w )
+            ( *brain )[ w ] = Exported::weights[ w ];
+        std::vector<std::array<float, NumOutput>> reference ( NumInputs );
+        auto report = [ & ] ( wchar_t const * name_, double const elapsed_, auto output_ ) noexcept {
+            float diff = 0.0f;
+            for ( int i = 0; i < NumInputs; ++i ) {
+                std::array<float, NumOutput> const out = output_ ( i );
+                for ( int o = 0; o < NumOutput; ++o )
+                    diff = std::max ( diff, std::abs ( out[ o ] - reference[ i ][ o ] ) );
+            }
+            std::wcout << L" export " << std::setw ( 8 ) << name_ << L" " << std::setprecision ( 2 ) << std::fixed
+                       << std::setw ( 10 ) << ( 1'000.0 * NumRepeats * NumInputs / elapsed_ ) << L" M feed-forwards/sec max diff "
+                       << std::setprecision ( 8 ) << diff << nl;
+        };
+        plf::nanotimer timer;
+        timer.start ( );
+        for ( int r = 0; r < NumRepeats; ++r )
+            for ( int i = 0; i < NumInputs; ++i ) {
+                float input[ NumInput ], output[ NumOutput ];
+                std::copy ( std::begin ( inputs[ i ].input ( ) ), std::end ( inputs[ i ].input ( ) ), input );
+                Exported::feed_forward ( input, output );
+                std::copy_n ( output, NumOutput, reference[ i ].data ( ) );
+            }
+        report ( L"exported", timer.get_elapsed_ns ( ), [ & ] ( int i_ ) noexcept { return reference[ i_ ]; } );
+        auto run = [ & ] ( wchar_t const * name_ ) noexcept {
+            std::vector<typename TheBrain::ibo_type> work_areas = inputs;
+            plf::nanotimer brain_timer;
+            brain_timer.start ( );
+            for ( int r = 0; r < NumRepeats; ++r )
+                for ( typename TheBrain::ibo_type & ibo : work_areas )
+                    ( void ) brain->feed_forward ( ibo.data ( ) );
+            report ( name_, brain_timer.get_elapsed_ns ( ), [ & ] ( int i_ ) noexcept {
+                std::array<float, NumOutput> out;
+                std::copy_n ( work_areas[ i_ ].data ( ) + TheBrain::NumInsOuts - NumOutput, NumOutput, out.data ( ) );
+                return out;
+            } );
+        };
+        if constexpr ( HasBackend ) {
+            Backend const backend = TheBrain::backend;
+            for ( Backend const b : { Backend::mkl, Backend::simd } ) {
+                TheBrain::backend = b;
+                run ( backend_name ( b ) );
+            }
+            TheBrain::backend = backend;
+        }
+        else {
+            run ( weight_name ( Weight{ } ) );
+        }
+    }
+
     void print_fitness ( ) const noexcept {
         for ( auto const & i : m_population )
             std::wcout << L'<' << i.fitness << L' ' << i.age << L'>';
@@ -251,6 +841,11 @@ struct Population {
         return dis;
     }
 
+    // Maintain the average.
+    static void add_fitness ( Individual & i_, float const f_ ) noexcept {
+        i_.fitness += ( f_ - i_.fitness ) / static_cast<float> ( i_.age );
+    }
+
     [[nodiscard]] static int sample ( ) noexcept { return uniformly_decreasing_discrete_distribution<BreedSize>{}( Rng::gen ( ) ); }
     [[nodiscard]] static std::tuple<int, int> sample_match ( ) noexcept {
         auto g = [] ( ) noexcept { return uniformly_decreasing_discrete_distribution<BreedSize>{}( Rng::gen ( ) ); };
@@ -314,6 +909,48 @@ struct Population {
     void load ( ) noexcept { load_from_file_bin ( *this, "z://tmp", "population" ); }
     void save ( ) const noexcept { save_to_file_bin ( *this, "z://tmp", "population" ); }
 
+    // Whether tune times the variant for this population.
+    [[nodiscard]] static constexpr bool tunable ( Evaluation const e_, Backend const b_ ) noexcept {
+        return ( Backend::simd == b_ or HasBackend ) and ( Evaluation::serial == e_ or IsCascade );
+    }
+
+    // Whether the saved variant is one tune could have picked (of this version, in range), a file that's
+    // out of date or damaged is retuned.
+    [[nodiscard]] static bool tunable ( TuningParams const & t_ ) noexcept {
+        return TuningParams::Version == t_.version and
+               std::any_of ( std::begin ( TuneVariants ), std::end ( TuneVariants ), [ & ] ( auto const & v_ ) noexcept {
+                   return static_cast<int> ( v_.first ) == t_.evaluation and static_cast<int> ( v_.second ) == t_.backend and
+                          tunable ( v_.first, v_.second );
+               } );
+    }
+
+    void variant ( Evaluation const e_, Backend const b_ ) noexcept {
+        m_evaluation = e_;
+        if constexpr ( HasBackend )
+            TheBrain::backend = b_;
+    }
+
+    [[nodiscard]] static std::string narrow ( wchar_t const * w_ ) {
+        std::string s;
+        while ( *w_ )
+            s += static_cast<char> ( *w_++ );
+        return s;
+    }
+
+    // The template parameters.
+    [[nodiscard]] static std::string topology ( ) {
+        return std::to_string ( PopSize ) + ' ' + std::to_string ( FieldSize ) + ' ' + std::to_string ( NumInput ) + ' ' +
+               std::to_string ( NumNeurons ) + ' ' + std::to_string ( NumOutput ) + ' ' +
+               narrow ( activation::name ( Activation{ } ) ) + ' ' + narrow ( weight_name ( Weight{ } ) ) +
+               ( IsCascade ? "" : " brain " + std::to_string ( TheBrain::NumWeights ) );
+    }
+
+    static constexpr char const s_tuning_file[]{ "z://tmp//population.tuning.json" };
+    static constexpr char const s_tuning_name[]{ "tuning" };
+
     std::vector<Individual> m_population{ PopSize };
-    int m_generation = 0;
+    int m_generation            = 0;
+    Evaluation m_evaluation     = NumNeurons < TheBrainSplit::MinNumNeurons ? Evaluation::serial : Evaluation::split;
+    Quantization m_quantization = Quantization::none;
+    float m_prune_threshold     = 0.0f;
 };
@@ -0,0 +1,130 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <array>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// A run (all the episodes of an individual) as a coroutine, it suspends on every inference (see
+// Inference) and returns (co_return) its fitness. A run starts suspended, it's the scheduler that
+// resumes it, until it's done.
+class Run {
+
+    public:
+    struct promise_type {
+        float fitness = 0.0f;
+
+        [[nodiscard]] Run get_return_object ( ) noexcept { return Run{ handle::from_promise ( *this ) }; }
+        [[nodiscard]] std::suspend_always initial_suspend ( ) const noexcept { return { }; }
+        [[nodiscard]] std::suspend_always final_suspend ( ) const noexcept { return { }; }
+        void return_value ( float const f_ ) noexcept { fitness = f_; }
+        void unhandled_exception ( ) const noexcept { std::terminate ( ); }
+    };
+
+    using handle = std::coroutine_handle<promise_type>;
+
+    Run ( ) noexcept = default;
+    Run ( Run const & ) = delete;
+    Run ( Run && o_ ) noexcept : m_handle{ std::exchange ( o_.m_handle, nullptr ) } {}
+    ~Run ( ) noexcept {
+        if ( m_handle )
+            m_handle.destroy ( );
+    }
+
+    Run & operator= ( Run const & ) = delete;
+    Run & operator= ( Run && o_ ) noexcept {
+        if ( this != &o_ ) {
+            if ( m_handle )
+                m_handle.destroy ( );
+            m_handle = std::exchange ( o_.m_handle, nullptr );
+        }
+        return *this;
+    }
+
+    void resume ( ) const noexcept { m_handle.resume ( ); }
+
+    [[nodiscard]] bool done ( ) const noexcept { return m_handle.done ( ); }
+    [[nodiscard]] float fitness ( ) const noexcept { return m_handle.promise ( ).fitness; }
+
+    private:
+    explicit Run ( handle const h_ ) noexcept : m_handle{ h_ } {}
+
+    handle m_handle = nullptr;
+};
+
+// Awaited by a run after writing its observation into its lane of the batch work area, the run is
+// resumed once the scheduler ran the brains of all lanes, its output is then in its lane.
+struct Inference {
+    [[nodiscard]] bool await_ready ( ) const noexcept { return false; }
+    void await_suspend ( std::coroutine_handle<> ) const noexcept {}
+    void await_resume ( ) const noexcept {}
+};
+
+// Plays num_runs_ runs, Lanes of them at a time, every one in its own lane. Every round, all runs that
+// are suspended (on an inference) share one call of feed_forward_ ( ) (the batched inference of all
+// lanes), after which all of them are resumed. When a run is done, its lane starts the next run right
+// away, so the lanes stay busy until the last runs (unlike lockstep, where a batch plays until its
+// longest run is done). start_ ( lane, i ) returns run i in lane (it's made ready to run in it, its
+// network assigned to the lane of the batch brain), finish_ ( i, fitness ) takes the result of run i.
+template<int Lanes, typename Start, typename FeedForward, typename Finish>
+void schedule ( int const num_runs_, Start start_, FeedForward feed_forward_, Finish finish_ ) noexcept {
+    std::array<Run, Lanes> runs;
+    std::array<int, Lanes> index;
+    std::array<bool, Lanes> active;
+    int next = 0;
+    // Starts runs in lane l_ until one suspends, returns false if there are none left.
+    auto fill = [ & ] ( int const l_ ) noexcept {
+        while ( next < num_runs_ ) {
+            index[ l_ ] = next;
+            runs[ l_ ]  = start_ ( l_, next++ );
+            runs[ l_ ].resume ( );
+            if ( not runs[ l_ ].done ( ) )
+                return true;
+            finish_ ( index[ l_ ], runs[ l_ ].fitness ( ) );
+        }
+        runs[ l_ ] = Run{ };
+        return false;
+    };
+    int num_active = 0;
+    for ( int l = 0; l < Lanes; ++l )
+        num_active += ( active[ l ] = fill ( l ) );
+    while ( num_active ) {
+        feed_forward_ ( ); // Run the data of all lanes.
+        for ( int l = 0; l < Lanes; ++l ) {
+            if ( active[ l ] ) {
+                runs[ l ].resume ( );
+                if ( runs[ l ].done ( ) ) {
+                    finish_ ( index[ l ], runs[ l ].fitness ( ) );
+                    if ( not( active[ l ] = fill ( l ) ) )
+                        --num_active;
+                }
+            }
+        }
+    }
+}
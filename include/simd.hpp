@@ -0,0 +1,839 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+#include <immintrin.h>
+
+// The instruction set traits below are compiled for their own instruction set, whatever the rest of
+// the translation unit is compiled for, the kernels are forced inline, so they get compiled for the
+// instruction set of their caller (the entry points in dispatch.hpp). MSVC makes all intrinsics
+// available everywhere. To clang, avx512bw implies avx512f, fma and f16c.
+#if defined( __clang__ )
+#    define SIMD_INLINE inline __attribute__ ( ( always_inline ) )
+#    define SIMD_TARGET_BEGIN_SSE42                                                                                                \
+        _Pragma ( "clang attribute push ( __attribute__ ( ( target ( \"sse4.2\" ) ) ), apply_to = function )" )
+#    define SIMD_TARGET_BEGIN_AVX2                                                                                                 \
+        _Pragma ( "clang attribute push ( __attribute__ ( ( target ( \"avx2,fma,f16c\" ) ) ), apply_to = function )" )
+#    define SIMD_TARGET_BEGIN_AVX512                                                                                               \
+        _Pragma ( "clang attribute push ( __attribute__ ( ( target ( \"avx512f,avx512bw,fma,f16c\" ) ) ), apply_to = function )" )
+#    define SIMD_TARGET_BEGIN_AVX2_VNNI                                                                                            \
+        _Pragma ( "clang attribute push ( __attribute__ ( ( target ( \"avx2,fma,f16c,avxvnni\" ) ) ), apply_to = function )" )
+#    define SIMD_TARGET_BEGIN_AVX512_VNNI                                                                                          \
+        _Pragma ( "clang attribute push ( __attribute__ ( ( target ( \"avx512bw,avx512vnni\" ) ) ), apply_to = function )" )
+#    define SIMD_TARGET_END _Pragma ( "clang attribute pop" )
+#elif defined( __GNUC__ )
+#    define SIMD_INLINE inline __attribute__ ( ( always_inline ) )
+#    define SIMD_TARGET_BEGIN_SSE42 _Pragma ( "GCC push_options" ) _Pragma ( "GCC target ( \"sse4.2\" )" )
+#    define SIMD_TARGET_BEGIN_AVX2 _Pragma ( "GCC push_options" ) _Pragma ( "GCC target ( \"avx2,fma,f16c\" )" )
+#    define SIMD_TARGET_BEGIN_AVX512 _Pragma ( "GCC push_options" ) _Pragma ( "GCC target ( \"avx512f,avx512bw,fma,f16c\" )" )
+#    define SIMD_TARGET_BEGIN_AVX2_VNNI _Pragma ( "GCC push_options" ) _Pragma ( "GCC target ( \"avx2,fma,f16c,avxvnni\" )" )
+#    define SIMD_TARGET_BEGIN_AVX512_VNNI                                                                                          \
+        _Pragma ( "GCC push_options" ) _Pragma ( "GCC target ( \"avx512f,avx512bw,avx512vnni,fma,f16c\" )" )
+#    define SIMD_TARGET_END _Pragma ( "GCC pop_options" )
+#else
+#    define SIMD_INLINE __forceinline
+#    define SIMD_TARGET_BEGIN_SSE42
+#    define SIMD_TARGET_BEGIN_AVX2
+#    define SIMD_TARGET_BEGIN_AVX512
+#    define SIMD_TARGET_BEGIN_AVX2_VNNI
+#    define SIMD_TARGET_BEGIN_AVX512_VNNI
+#    define SIMD_TARGET_END
+#endif
+
+// The kernels (and the vector activations) are not compiled for an instruction set themselves, they
+// are forced inline into the entry points and no vector crosses a call. GCC warns about the vector
+// arguments and results (-Wpsabi) anyway, between these.
+#if defined( __GNUC__ )
+#    define SIMD_KERNELS_BEGIN _Pragma ( "GCC diagnostic push" ) _Pragma ( "GCC diagnostic ignored \"-Wpsabi\"" )
+#    define SIMD_KERNELS_END _Pragma ( "GCC diagnostic pop" )
+#else
+#    define SIMD_KERNELS_BEGIN
+#    define SIMD_KERNELS_END
+#endif
+
+namespace simd {
+
+// Half precision storage of weights, IEEE binary16 and bfloat16 (the upper half of a float).
+enum class fp16 : std::uint16_t {};
+enum class bf16 : std::uint16_t {};
+
+template<typename Weight>
+inline constexpr bool is_half_v = std::is_same_v<Weight, fp16> or std::is_same_v<Weight, bf16>;
+
+// The conversions of single weights (mutation, serialization, broadcast weights). They use F16C
+// only if the translation unit is compiled for it (and then require it), the portable conversion
+// otherwise. The vector loads of the instruction sets below widen halves in the dispatched kernels.
+[[nodiscard]] inline float to_float ( float f_ ) noexcept { return f_; }
+
+[[nodiscard]] inline float to_float ( fp16 h_ ) noexcept {
+#if defined( __F16C__ )
+    return _cvtsh_ss ( static_cast<std::uint16_t> ( h_ ) );
+#else
+    std::uint32_t const h = static_cast<std::uint16_t> ( h_ ), sign = ( h & 0x8000u ) << 16, exp = ( h >> 10 ) & 0x1Fu,
+                        mant = h & 0x3FFu;
+    if ( 0u == exp ) // Zero or subnormal.
+        return std::bit_cast<float> ( sign | std::bit_cast<std::uint32_t> ( mant * 0x1p-24f ) );
+    if ( 0x1Fu == exp ) // Inf or NaN.
+        return std::bit_cast<float> ( sign | 0x7F80'0000u | ( mant << 13 ) );
+    return std::bit_cast<float> ( sign | ( ( exp + 112u ) << 23 ) | ( mant << 13 ) );
+#endif
+}
+
+[[nodiscard]] inline float to_float ( bf16 h_ ) noexcept {
+    return std::bit_cast<float> ( static_cast<std::uint32_t> ( static_cast<std::uint16_t> ( h_ ) ) << 16 );
+}
+
+// Rounds to nearest even, out of range fp16 becomes inf.
+template<typename Weight>
+[[nodiscard]] inline Weight from_float ( float f_ ) noexcept {
+    if constexpr ( std::is_same_v<Weight, fp16> ) {
+#if defined( __F16C__ )
+        return static_cast<fp16> ( _cvtss_sh ( f_, _MM_FROUND_TO_NEAREST_INT ) );
+#else
+        std::uint32_t const sign = ( std::bit_cast<std::uint32_t> ( f_ ) >> 16 ) & 0x8000u;
+        float const a            = std::abs ( f_ );
+        if ( a != a )
+            return static_cast<fp16> ( sign | 0x7E00u );
+        if ( a >= 65'520.0f )
+            return static_cast<fp16> ( sign | 0x7C00u );
+        if ( a < 0x1p-14f ) // Subnormal.
+            return static_cast<fp16> ( sign | static_cast<std::uint32_t> ( std::nearbyint ( a * 0x1p24f ) ) );
+        std::uint32_t const b = std::bit_cast<std::uint32_t> ( a );
+        return static_cast<fp16> ( sign | ( ( b + 0xFFFu + ( ( b >> 13 ) & 1u ) - ( 112u << 23 ) ) >> 13 ) );
+#endif
+    }
+    else if constexpr ( std::is_same_v<Weight, bf16> ) {
+        std::uint32_t const b = std::bit_cast<std::uint32_t> ( f_ );
+        if ( f_ != f_ )
+            return static_cast<bf16> ( ( b >> 16 ) | 0x40u );
+        return static_cast<bf16> ( ( b + 0x7FFFu + ( ( b >> 16 ) & 1u ) ) >> 16 );
+    }
+    else {
+        return f_;
+    }
+}
+
+// Instruction set traits, all kernels are written in terms of these. Weights load from float, fp16
+// or bf16, the latter are widened to float on the fly.
+
+struct scalar {
+
+    using vec = float;
+
+    static constexpr int width = 1;
+
+    [[nodiscard]] static vec zero ( ) noexcept { return 0.0f; }
+    template<typename Weight>
+    [[nodiscard]] static vec load ( Weight const * p_ ) noexcept {
+        return to_float ( *p_ );
+    }
+    [[nodiscard]] static vec load_aligned ( float const * p_ ) noexcept { return *p_; }
+    // Loads the first N floats, the other lanes are zero.
+    template<int N, typename Weight>
+    [[nodiscard]] static vec load_partial ( Weight const * p_ ) noexcept {
+        return to_float ( *p_ );
+    }
+    static void store ( float * p_, vec v_ ) noexcept { *p_ = v_; }
+    [[nodiscard]] static vec broadcast ( float f_ ) noexcept { return f_; }
+    [[nodiscard]] static vec add ( vec a_, vec b_ ) noexcept { return a_ + b_; }
+    [[nodiscard]] static vec mul ( vec a_, vec b_ ) noexcept { return a_ * b_; }
+    [[nodiscard]] static vec div ( vec a_, vec b_ ) noexcept { return a_ / b_; }
+    [[nodiscard]] static vec min ( vec a_, vec b_ ) noexcept { return a_ < b_ ? a_ : b_; }
+    [[nodiscard]] static vec max ( vec a_, vec b_ ) noexcept { return a_ > b_ ? a_ : b_; }
+    [[nodiscard]] static vec abs ( vec a_ ) noexcept { return a_ < 0.0f ? -a_ : a_; }
+    [[nodiscard]] static vec fmadd ( vec a_, vec b_, vec c_ ) noexcept { return a_ * b_ + c_; }
+    [[nodiscard]] static float hsum ( vec v_ ) noexcept { return v_; }
+    // The 32-bit integer dot product of n_ 16-bit activations with 16- or 8-bit weights.
+    template<typename Weight>
+    [[nodiscard]] static std::int32_t dot ( std::int16_t const * a_, Weight const * w_, int const n_ ) noexcept {
+        std::int32_t s = 0;
+        for ( int i = 0; i < n_; ++i )
+            s += static_cast<std::int32_t> ( a_[ i ] ) * static_cast<std::int32_t> ( w_[ i ] );
+        return s;
+    }
+};
+
+SIMD_TARGET_BEGIN_SSE42
+
+struct sse42 {
+
+    using vec = __m128;
+
+    static constexpr int width = 4;
+
+    [[nodiscard]] static vec zero ( ) noexcept { return _mm_setzero_ps ( ); }
+    [[nodiscard]] static vec load ( float const * p_ ) noexcept { return _mm_loadu_ps ( p_ ); }
+    [[nodiscard]] static vec load_aligned ( float const * p_ ) noexcept { return _mm_load_ps ( p_ ); }
+    // Loads the first N floats, the other lanes are zero (and not touched in memory).
+    template<int N>
+    [[nodiscard]] static vec load_partial ( float const * p_ ) noexcept {
+        if constexpr ( N == 1 )
+            return _mm_load_ss ( p_ );
+        else if constexpr ( N == 2 )
+            return _mm_castsi128_ps ( _mm_loadl_epi64 ( reinterpret_cast<__m128i const *> ( p_ ) ) );
+        else if constexpr ( N == 3 )
+            return _mm_movelh_ps ( load_partial<2> ( p_ ), _mm_load_ss ( p_ + 2 ) );
+        else
+            return load ( p_ );
+    }
+    template<typename Half>
+    [[nodiscard]] static vec load ( Half const * p_ ) noexcept {
+        return widen<Half> ( _mm_loadl_epi64 ( reinterpret_cast<__m128i const *> ( p_ ) ) );
+    }
+    // Loads the first N halves, the other lanes are zero. Memory is read in whole 32-bit words, so the
+    // half following an odd N is read (but not used), the storage should cover it.
+    template<int N, typename Half>
+    [[nodiscard]] static vec load_partial ( Half const * p_ ) noexcept {
+        if constexpr ( N == width ) {
+            return load ( p_ );
+        }
+        else {
+            __m128i const h = N > 2 ? _mm_loadl_epi64 ( reinterpret_cast<__m128i const *> ( p_ ) ) : _mm_loadu_si32 ( p_ );
+            return _mm_and_ps ( widen<Half> ( h ), _mm_castsi128_ps ( _mm_setr_epi32 ( -( N > 0 ), -( N > 1 ), -( N > 2 ), 0 ) ) );
+        }
+    }
+    static void store ( float * p_, vec v_ ) noexcept { _mm_storeu_ps ( p_, v_ ); }
+    [[nodiscard]] static vec broadcast ( float f_ ) noexcept { return _mm_set1_ps ( f_ ); }
+    [[nodiscard]] static vec add ( vec a_, vec b_ ) noexcept { return _mm_add_ps ( a_, b_ ); }
+    [[nodiscard]] static vec mul ( vec a_, vec b_ ) noexcept { return _mm_mul_ps ( a_, b_ ); }
+    [[nodiscard]] static vec div ( vec a_, vec b_ ) noexcept { return _mm_div_ps ( a_, b_ ); }
+    [[nodiscard]] static vec min ( vec a_, vec b_ ) noexcept { return _mm_min_ps ( a_, b_ ); }
+    [[nodiscard]] static vec max ( vec a_, vec b_ ) noexcept { return _mm_max_ps ( a_, b_ ); }
+    [[nodiscard]] static vec abs ( vec a_ ) noexcept { return _mm_andnot_ps ( _mm_set1_ps ( -0.0f ), a_ ); }
+    // No fma, a multiply and an add (rounded twice).
+    [[nodiscard]] static vec fmadd ( vec a_, vec b_, vec c_ ) noexcept { return _mm_add_ps ( _mm_mul_ps ( a_, b_ ), c_ ); }
+    [[nodiscard]] static float hsum ( vec v_ ) noexcept {
+        __m128 const sh = _mm_movehdup_ps ( v_ );
+        __m128 const s  = _mm_add_ps ( v_, sh );
+        return _mm_cvtss_f32 ( _mm_add_ss ( s, _mm_movehl_ps ( sh, s ) ) );
+    }
+    // The 32-bit integer dot product of n_ 16-bit activations with 16- or 8-bit weights, n_ a multiple
+    // of 8 and both aligned to 8 elements. The 8-bit weights are widened to 16 bits in register, the
+    // pairs are multiplied and summed by pmaddwd.
+    template<typename Weight>
+    [[nodiscard]] static std::int32_t dot ( std::int16_t const * a_, Weight const * w_, int const n_ ) noexcept {
+        __m128i acc = _mm_setzero_si128 ( );
+        for ( int i = 0; i < n_; i += 8 ) {
+            __m128i const a = _mm_load_si128 ( reinterpret_cast<__m128i const *> ( a_ + i ) );
+            __m128i w;
+            if constexpr ( sizeof ( Weight ) == 1 )
+                w = _mm_cvtepi8_epi16 ( _mm_loadl_epi64 ( reinterpret_cast<__m128i const *> ( w_ + i ) ) );
+            else
+                w = _mm_load_si128 ( reinterpret_cast<__m128i const *> ( w_ + i ) );
+            acc = _mm_add_epi32 ( acc, _mm_madd_epi16 ( a, w ) );
+        }
+        return hsum_epi32 ( acc );
+    }
+
+    private:
+    [[nodiscard]] static std::int32_t hsum_epi32 ( __m128i s_ ) noexcept {
+        s_ = _mm_add_epi32 ( s_, _mm_shuffle_epi32 ( s_, _MM_SHUFFLE ( 1, 0, 3, 2 ) ) );
+        s_ = _mm_add_epi32 ( s_, _mm_shuffle_epi32 ( s_, _MM_SHUFFLE ( 2, 3, 0, 1 ) ) );
+        return _mm_cvtsi128_si32 ( s_ );
+    }
+
+    // No F16C, the fp16 bits are shifted into place and scaled by 2^112 (which takes care of the
+    // subnormals as well), inf and nan get their exponent set.
+    template<typename Half>
+    [[nodiscard]] static vec widen ( __m128i h_ ) noexcept {
+        __m128i const h = _mm_cvtepu16_epi32 ( h_ );
+        if constexpr ( std::is_same_v<Half, bf16> ) {
+            return _mm_castsi128_ps ( _mm_slli_epi32 ( h, 16 ) );
+        }
+        else {
+            __m128i const em = _mm_and_si128 ( h, _mm_set1_epi32 ( 0x7FFF ) );
+            __m128i const s  = _mm_slli_epi32 ( _mm_xor_si128 ( h, em ), 16 );
+            __m128 const f   = _mm_mul_ps ( _mm_castsi128_ps ( _mm_slli_epi32 ( em, 13 ) ), _mm_set1_ps ( 0x1p112f ) );
+            __m128i const e  = _mm_and_si128 ( _mm_cmpgt_epi32 ( em, _mm_set1_epi32 ( 0x7BFF ) ), _mm_set1_epi32 ( 0x7F80'0000 ) );
+            return _mm_castsi128_ps ( _mm_or_si128 ( _mm_or_si128 ( _mm_castps_si128 ( f ), e ), s ) );
+        }
+    }
+};
+
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX2
+
+struct avx2 {
+
+    using vec = __m256;
+
+    static constexpr int width = 8;
+
+    [[nodiscard]] static vec zero ( ) noexcept { return _mm256_setzero_ps ( ); }
+    [[nodiscard]] static vec load ( float const * p_ ) noexcept { return _mm256_loadu_ps ( p_ ); }
+    [[nodiscard]] static vec load_aligned ( float const * p_ ) noexcept { return _mm256_load_ps ( p_ ); }
+    // Loads the first N floats, the other lanes are zero (and not touched in memory).
+    template<int N>
+    [[nodiscard]] static vec load_partial ( float const * p_ ) noexcept {
+        if constexpr ( N == width ) {
+            return load ( p_ );
+        }
+        else {
+            return _mm256_maskload_ps ( p_, _mm256_setr_epi32 ( -( N > 0 ), -( N > 1 ), -( N > 2 ), -( N > 3 ), -( N > 4 ),
+                                                                -( N > 5 ), -( N > 6 ), -( N > 7 ) ) );
+        }
+    }
+    template<typename Half>
+    [[nodiscard]] static vec load ( Half const * p_ ) noexcept {
+        return widen<Half> ( _mm_loadu_si128 ( reinterpret_cast<__m128i const *> ( p_ ) ) );
+    }
+    // Loads the first N halves, the other lanes are zero. Memory is read in whole 32-bit words, so the
+    // half following an odd N is read (but not used), the storage should cover it.
+    template<int N, typename Half>
+    [[nodiscard]] static vec load_partial ( Half const * p_ ) noexcept {
+        if constexpr ( N == width ) {
+            return load ( p_ );
+        }
+        else {
+            __m128i const h = _mm_maskload_epi32 ( reinterpret_cast<int const *> ( p_ ),
+                                                   _mm_setr_epi32 ( -( N > 0 ), -( N > 2 ), -( N > 4 ), -( N > 6 ) ) );
+            return _mm256_and_ps ( widen<Half> ( h ),
+                                   _mm256_castsi256_ps ( _mm256_setr_epi32 ( -( N > 0 ), -( N > 1 ), -( N > 2 ), -( N > 3 ),
+                                                                             -( N > 4 ), -( N > 5 ), -( N > 6 ), -( N > 7 ) ) ) );
+        }
+    }
+    static void store ( float * p_, vec v_ ) noexcept { _mm256_storeu_ps ( p_, v_ ); }
+    [[nodiscard]] static vec broadcast ( float f_ ) noexcept { return _mm256_set1_ps ( f_ ); }
+    [[nodiscard]] static vec add ( vec a_, vec b_ ) noexcept { return _mm256_add_ps ( a_, b_ ); }
+    [[nodiscard]] static vec mul ( vec a_, vec b_ ) noexcept { return _mm256_mul_ps ( a_, b_ ); }
+    [[nodiscard]] static vec div ( vec a_, vec b_ ) noexcept { return _mm256_div_ps ( a_, b_ ); }
+    [[nodiscard]] static vec min ( vec a_, vec b_ ) noexcept { return _mm256_min_ps ( a_, b_ ); }
+    [[nodiscard]] static vec max ( vec a_, vec b_ ) noexcept { return _mm256_max_ps ( a_, b_ ); }
+    [[nodiscard]] static vec abs ( vec a_ ) noexcept { return _mm256_andnot_ps ( _mm256_set1_ps ( -0.0f ), a_ ); }
+    [[nodiscard]] static vec fmadd ( vec a_, vec b_, vec c_ ) noexcept { return _mm256_fmadd_ps ( a_, b_, c_ ); }
+    [[nodiscard]] static float hsum ( vec v_ ) noexcept {
+        __m128 s        = _mm_add_ps ( _mm256_castps256_ps128 ( v_ ), _mm256_extractf128_ps ( v_, 1 ) );
+        __m128 const sh = _mm_movehdup_ps ( s );
+        s               = _mm_add_ps ( s, sh );
+        return _mm_cvtss_f32 ( _mm_add_ss ( s, _mm_movehl_ps ( sh, s ) ) );
+    }
+    // The 32-bit integer dot product of n_ 16-bit activations with 16- or 8-bit weights, n_ a multiple
+    // of 16 and both aligned to 16 elements, as sse42::dot.
+    template<typename Weight>
+    [[nodiscard]] static std::int32_t dot ( std::int16_t const * a_, Weight const * w_, int const n_ ) noexcept {
+        __m256i acc = _mm256_setzero_si256 ( );
+        for ( int i = 0; i < n_; i += 16 )
+            acc = _mm256_add_epi32 ( acc, _mm256_madd_epi16 ( load_epi16 ( a_ + i ), load_epi16 ( w_ + i ) ) );
+        return hsum_epi32 ( acc );
+    }
+
+    protected:
+    // 16 aligned 16-bit integers, 8-bit ones are widened.
+    template<typename Int>
+    [[nodiscard]] static __m256i load_epi16 ( Int const * p_ ) noexcept {
+        if constexpr ( sizeof ( Int ) == 1 )
+            return _mm256_cvtepi8_epi16 ( _mm_load_si128 ( reinterpret_cast<__m128i const *> ( p_ ) ) );
+        else
+            return _mm256_load_si256 ( reinterpret_cast<__m256i const *> ( p_ ) );
+    }
+    [[nodiscard]] static std::int32_t hsum_epi32 ( __m256i v_ ) noexcept {
+        __m128i s = _mm_add_epi32 ( _mm256_castsi256_si128 ( v_ ), _mm256_extracti128_si256 ( v_, 1 ) );
+        s         = _mm_add_epi32 ( s, _mm_shuffle_epi32 ( s, _MM_SHUFFLE ( 1, 0, 3, 2 ) ) );
+        s         = _mm_add_epi32 ( s, _mm_shuffle_epi32 ( s, _MM_SHUFFLE ( 2, 3, 0, 1 ) ) );
+        return _mm_cvtsi128_si32 ( s );
+    }
+
+    private:
+    template<typename Half>
+    [[nodiscard]] static vec widen ( __m128i h_ ) noexcept {
+        if constexpr ( std::is_same_v<Half, bf16> ) {
+            return _mm256_castsi256_ps ( _mm256_slli_epi32 ( _mm256_cvtepu16_epi32 ( h_ ), 16 ) );
+        }
+        else {
+            return _mm256_cvtph_ps ( h_ );
+        }
+    }
+};
+
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX512
+
+struct avx512 {
+
+    using vec = __m512;
+
+    static constexpr int width = 16;
+
+    [[nodiscard]] static vec zero ( ) noexcept { return _mm512_setzero_ps ( ); }
+    [[nodiscard]] static vec load ( float const * p_ ) noexcept { return _mm512_loadu_ps ( p_ ); }
+    [[nodiscard]] static vec load_aligned ( float const * p_ ) noexcept { return _mm512_load_ps ( p_ ); }
+    // Loads the first N floats, the other lanes are zero (and not touched in memory).
+    template<int N>
+    [[nodiscard]] static vec load_partial ( float const * p_ ) noexcept {
+        if constexpr ( N == width ) {
+            return load ( p_ );
+        }
+        else {
+            return _mm512_maskz_loadu_ps ( static_cast<__mmask16> ( ( 1u << N ) - 1u ), p_ );
+        }
+    }
+    template<typename Half>
+    [[nodiscard]] static vec load ( Half const * p_ ) noexcept {
+        return widen<Half> ( _mm256_loadu_si256 ( reinterpret_cast<__m256i const *> ( p_ ) ) );
+    }
+    // Loads the first N halves, the other lanes are zero. Memory is read in whole 32-bit words, so the
+    // half following an odd N is read (but not used), the storage should cover it.
+    template<int N, typename Half>
+    [[nodiscard]] static vec load_partial ( Half const * p_ ) noexcept {
+        if constexpr ( N == width ) {
+            return load ( p_ );
+        }
+        else {
+            __m512i const h = _mm512_maskz_loadu_epi32 ( static_cast<__mmask16> ( ( 1u << ( ( N + 1 ) / 2 ) ) - 1u ), p_ );
+            return _mm512_maskz_mov_ps ( static_cast<__mmask16> ( ( 1u << N ) - 1u ),
+                                         widen<Half> ( _mm512_castsi512_si256 ( h ) ) );
+        }
+    }
+    static void store ( float * p_, vec v_ ) noexcept { _mm512_storeu_ps ( p_, v_ ); }
+    [[nodiscard]] static vec broadcast ( float f_ ) noexcept { return _mm512_set1_ps ( f_ ); }
+    [[nodiscard]] static vec add ( vec a_, vec b_ ) noexcept { return _mm512_add_ps ( a_, b_ ); }
+    [[nodiscard]] static vec mul ( vec a_, vec b_ ) noexcept { return _mm512_mul_ps ( a_, b_ ); }
+    [[nodiscard]] static vec div ( vec a_, vec b_ ) noexcept { return _mm512_div_ps ( a_, b_ ); }
+    [[nodiscard]] static vec min ( vec a_, vec b_ ) noexcept { return _mm512_min_ps ( a_, b_ ); }
+    [[nodiscard]] static vec max ( vec a_, vec b_ ) noexcept { return _mm512_max_ps ( a_, b_ ); }
+    [[nodiscard]] static vec abs ( vec a_ ) noexcept { return _mm512_abs_ps ( a_ ); }
+    [[nodiscard]] static vec fmadd ( vec a_, vec b_, vec c_ ) noexcept { return _mm512_fmadd_ps ( a_, b_, c_ ); }
+    [[nodiscard]] static float hsum ( vec v_ ) noexcept { return _mm512_reduce_add_ps ( v_ ); }
+    // The 32-bit integer dot product of n_ 16-bit activations with 16- or 8-bit weights, n_ a multiple
+    // of 32 and both aligned to 32 elements, as sse42::dot.
+    template<typename Weight>
+    [[nodiscard]] static std::int32_t dot ( std::int16_t const * a_, Weight const * w_, int const n_ ) noexcept {
+        __m512i acc = _mm512_setzero_si512 ( );
+        for ( int i = 0; i < n_; i += 32 )
+            acc = _mm512_add_epi32 ( acc, _mm512_madd_epi16 ( load_epi16 ( a_ + i ), load_epi16 ( w_ + i ) ) );
+        return _mm512_reduce_add_epi32 ( acc );
+    }
+
+    protected:
+    // 32 aligned 16-bit integers, 8-bit ones are widened.
+    template<typename Int>
+    [[nodiscard]] static __m512i load_epi16 ( Int const * p_ ) noexcept {
+        if constexpr ( sizeof ( Int ) == 1 )
+            return _mm512_cvtepi8_epi16 ( _mm256_load_si256 ( reinterpret_cast<__m256i const *> ( p_ ) ) );
+        else
+            return _mm512_load_si512 ( p_ );
+    }
+
+    private:
+    template<typename Half>
+    [[nodiscard]] static vec widen ( __m256i h_ ) noexcept {
+        if constexpr ( std::is_same_v<Half, bf16> )
+            return _mm512_castsi512_ps ( _mm512_slli_epi32 ( _mm512_cvtepu16_epi32 ( h_ ), 16 ) );
+        else
+            return _mm512_cvtph_ps ( h_ );
+    }
+};
+
+SIMD_TARGET_END
+
+// The VNNI extensions of avx2 and avx512, the integer dot product multiplies, sums the pairs and
+// accumulates in one instruction (vpdpwssd), the rest is that of the instruction set extended.
+
+SIMD_TARGET_BEGIN_AVX2_VNNI
+
+struct avx2_vnni : avx2 {
+    template<typename Weight>
+    [[nodiscard]] static std::int32_t dot ( std::int16_t const * a_, Weight const * w_, int const n_ ) noexcept {
+        __m256i acc = _mm256_setzero_si256 ( );
+        for ( int i = 0; i < n_; i += 16 )
+            acc = _mm256_dpwssd_avx_epi32 ( acc, load_epi16 ( a_ + i ), load_epi16 ( w_ + i ) );
+        return hsum_epi32 ( acc );
+    }
+};
+
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX512_VNNI
+
+struct avx512_vnni : avx512 {
+    template<typename Weight>
+    [[nodiscard]] static std::int32_t dot ( std::int16_t const * a_, Weight const * w_, int const n_ ) noexcept {
+        __m512i acc = _mm512_setzero_si512 ( );
+        for ( int i = 0; i < n_; i += 32 )
+            acc = _mm512_dpwssd_epi32 ( acc, load_epi16 ( a_ + i ), load_epi16 ( w_ + i ) );
+        return _mm512_reduce_add_epi32 ( acc );
+    }
+};
+
+SIMD_TARGET_END
+
+SIMD_KERNELS_BEGIN
+
+// The number of floats in a cache line, a whole number of vectors for all of the above.
+inline constexpr int CacheLineFloats = 64 / sizeof ( float );
+
+[[nodiscard]] constexpr int round_up ( int n_, int m_ ) noexcept { return ( ( n_ + m_ - 1 ) / m_ ) * m_; }
+
+// Feed-forward of a cascade of NumNeurons neurons, fed by NumIns inputs (bias included). The
+// weights are stored row after row, row n having length NumIns + n. The input part of the work
+// area is loaded once and stays in registers for all rows, the outputs of the neurons are kept
+// in registers as well and only get written back to the work area for the caller.
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, typename Weight>
+SIMD_INLINE void cascade ( float * const ibo_, Weight const * wgt_ ) noexcept {
+    using vec               = typename Isa::vec;
+    constexpr int W         = Isa::width;
+    constexpr int NumChunks = ( NumIns + W - 1 ) / W;
+    constexpr int Tail      = NumIns - ( NumChunks - 1 ) * W;
+    vec in[ NumChunks ];
+    for ( int c = 0; c < NumChunks - 1; ++c )
+        in[ c ] = Isa::load ( ibo_ + c * W );
+    in[ NumChunks - 1 ] = Isa::template load_partial<Tail> ( ibo_ + ( NumChunks - 1 ) * W );
+    float out[ NumNeurons ];
+    for ( int n = 0; n < NumNeurons; wgt_ += NumIns + n++ ) {
+        vec acc = Isa::zero ( );
+        for ( int c = 0; c < NumChunks - 1; ++c )
+            acc = Isa::fmadd ( in[ c ], Isa::load ( wgt_ + c * W ), acc );
+        acc     = Isa::fmadd ( in[ NumChunks - 1 ], Isa::template load_partial<Tail> ( wgt_ + ( NumChunks - 1 ) * W ), acc );
+        float s = Isa::hsum ( acc );
+        for ( int m = 0; m < n; ++m )
+            s += out[ m ] * to_float ( wgt_[ NumIns + m ] );
+        ibo_[ NumIns + n ] = out[ n ] = Activation::scalar ( s );
+    }
+}
+
+// The cascade, fully unrolled, for small networks. Straight-line code (folds over index sequences),
+// all offsets are compile time constants, the inputs and the outputs of the neurons stay in
+// registers, the outputs are stored to the work area at the end.
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, typename Weight>
+struct Unrolled {
+
+    using vec = typename Isa::vec;
+
+    static constexpr int W         = Isa::width;
+    static constexpr int NumChunks = ( NumIns + W - 1 ) / W;
+    static constexpr int Tail      = NumIns - ( NumChunks - 1 ) * W;
+
+    template<int N>
+    using sequence = std::make_integer_sequence<int, N>;
+
+    template<int C, typename T>
+    SIMD_INLINE static void chunk ( vec & v_, T const * p_ ) noexcept {
+        if constexpr ( C < NumChunks - 1 )
+            v_ = Isa::load ( p_ + C * W );
+        else
+            v_ = Isa::template load_partial<Tail> ( p_ + C * W );
+    }
+
+    template<int... C>
+    SIMD_INLINE static void load ( vec * const in_, float const * const ibo_, std::integer_sequence<int, C...> ) noexcept {
+        ( chunk<C> ( in_[ C ], ibo_ ), ... );
+    }
+
+    template<int... C>
+    [[nodiscard]] SIMD_INLINE static float dot ( vec const * const in_, Weight const * const w_,
+                                                 std::integer_sequence<int, C...> ) noexcept {
+        vec acc = Isa::zero ( ), w;
+        ( ( chunk<C> ( w, w_ ), acc = Isa::fmadd ( in_[ C ], w, acc ) ), ... );
+        return Isa::hsum ( acc );
+    }
+
+    // Neuron N, its row starts at N * NumIns + N * ( N - 1 ) / 2, M are the earlier neurons.
+    template<int N, int... M>
+    SIMD_INLINE static void neuron ( vec const * const in_, float * const out_, Weight const * const wgt_,
+                                     std::integer_sequence<int, M...> ) noexcept {
+        Weight const * const w = wgt_ + N * NumIns + ( N * ( N - 1 ) ) / 2;
+        float s                = dot ( in_, w, sequence<NumChunks>{ } );
+        ( ( s += out_[ M ] * to_float ( w[ NumIns + M ] ) ), ... );
+        out_[ N ] = Activation::scalar ( s );
+    }
+
+    template<int... N>
+    SIMD_INLINE static void run ( float * const ibo_, Weight const * const wgt_, std::integer_sequence<int, N...> ) noexcept {
+        vec in[ NumChunks ];
+        float out[ NumNeurons ];
+        load ( in, ibo_, sequence<NumChunks>{ } );
+        ( neuron<N> ( in, out, wgt_, sequence<N>{ } ), ... );
+        ( ( ibo_[ NumIns + N ] = out[ N ] ), ... );
+    }
+};
+
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, typename Weight>
+SIMD_INLINE void cascade_unrolled ( float * const ibo_, Weight const * const wgt_ ) noexcept {
+    Unrolled<Isa, Activation, NumIns, NumNeurons, Weight>::run ( ibo_, wgt_, std::make_integer_sequence<int, NumNeurons>{ } );
+}
+
+// Feed-forward of a cascade with a padded weight layout, row n starts on a RowAlign boundary and is
+// zero-padded to a multiple of RowAlign floats, the (aligned) work area is padded to a multiple of
+// RowAlign floats as well. All weight loads are whole, aligned vectors, there is no remainder. The
+// inputs and the outputs of the neurons are kept in registers, an output is added into its lane
+// with a unit vector, the outputs are only stored to the work area for the caller.
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, int RowAlign = CacheLineFloats>
+SIMD_INLINE void cascade_padded ( float * const ibo_, float const * wgt_ ) noexcept {
+    using vec               = typename Isa::vec;
+    constexpr int W         = Isa::width;
+    constexpr int NumChunks = round_up ( NumIns + NumNeurons, RowAlign ) / W;
+    static_assert ( RowAlign % W == 0, "the rows should be padded to a multiple of the vector width" );
+    alignas ( 64 ) static constexpr auto unit = [] ( ) {
+        std::array<float, W * W> u{ };
+        for ( int i = 0; i < W; ++i )
+            u[ i * W + i ] = 1.0f;
+        return u;
+    }( );
+    vec in[ NumChunks ];
+    for ( int c = 0; c < NumIns / W; ++c )
+        in[ c ] = Isa::load_aligned ( ibo_ + c * W );
+    if constexpr ( NumIns % W != 0 ) // The outputs of the previous call are masked out.
+        in[ NumIns / W ] = Isa::template load_partial<NumIns % W> ( ibo_ + ( NumIns / W ) * W );
+    for ( int c = ( NumIns + W - 1 ) / W; c < NumChunks; ++c )
+        in[ c ] = Isa::zero ( );
+    for ( int n = 0; n < NumNeurons; ++n ) {
+        int const num_chunks = round_up ( NumIns + n, RowAlign ) / W;
+        vec acc0             = Isa::zero ( ), acc1 = Isa::zero ( );
+        int c                = 0;
+        for ( ; c < num_chunks - 1; c += 2 ) {
+            acc0 = Isa::fmadd ( in[ c ], Isa::load_aligned ( wgt_ + c * W ), acc0 );
+            acc1 = Isa::fmadd ( in[ c + 1 ], Isa::load_aligned ( wgt_ + ( c + 1 ) * W ), acc1 );
+        }
+        if ( c < num_chunks )
+            acc0 = Isa::fmadd ( in[ c ], Isa::load_aligned ( wgt_ + c * W ), acc0 );
+        int const i     = NumIns + n;
+        float const out = Activation::scalar ( Isa::hsum ( Isa::add ( acc0, acc1 ) ) );
+        in[ i / W ]     = Isa::fmadd ( Isa::broadcast ( out ), Isa::load_aligned ( unit.data ( ) + ( i % W ) * W ), in[ i / W ] );
+        ibo_[ i ]       = out;
+        wgt_ += num_chunks * W;
+    }
+}
+
+// The neurons of a cascade in order, given the contributions of the inputs in acc_ (NumNeurons
+// rounded up to RowAlign, aligned), the output of each neuron is pushed into the accumulators of
+// all later neurons, an axpy with its column of the triangular block. Column n covers the neurons
+// from n + 1 (rounded down to RowAlign) up to NumNeurons (rounded up to RowAlign), zero-padded.
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, int RowAlign = CacheLineFloats>
+SIMD_INLINE void triangle ( float * const ibo_, float * const acc_, float const * tri_ ) noexcept {
+    using vec             = typename Isa::vec;
+    constexpr int W       = Isa::width;
+    constexpr int NumAccs = round_up ( NumNeurons, RowAlign );
+    for ( int n = 0; n < NumNeurons; ++n ) {
+        float const out    = Activation::scalar ( acc_[ n ] );
+        ibo_[ NumIns + n ] = out;
+        vec const o        = Isa::broadcast ( out );
+        for ( int m = ( ( n + 1 ) / RowAlign ) * RowAlign; m < NumAccs; m += W, tri_ += W )
+            Isa::store ( acc_ + m, Isa::fmadd ( o, Isa::load_aligned ( tri_ ), Isa::load_aligned ( acc_ + m ) ) );
+    }
+}
+
+// acc_ += a_ * x_, over N (a multiple of the vector width) aligned floats.
+template<typename Isa, int N>
+SIMD_INLINE void axpy ( float * const acc_, float const a_, float const * const x_ ) noexcept {
+    typename Isa::vec const a = Isa::broadcast ( a_ );
+    for ( int i = 0; i < N; i += Isa::width )
+        Isa::store ( acc_ + i, Isa::fmadd ( a, Isa::load_aligned ( x_ + i ), Isa::load_aligned ( acc_ + i ) ) );
+}
+
+// Feed-forward of a cascade in two passes, for wide networks. First the contributions of the inputs
+// to all neurons, a dense GEMV over the input block (four rows at a time, sharing the loads of the
+// inputs). Then the neurons in order, pushing their outputs forward (triangle). The rows of the
+// input block are RowAlign floats aligned and padded.
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, int RowAlign = CacheLineFloats>
+SIMD_INLINE void cascade_split ( float * const ibo_, float const * const inp_, float const * tri_ ) noexcept {
+    using vec               = typename Isa::vec;
+    constexpr int W         = Isa::width;
+    constexpr int NumChunks = ( NumIns + W - 1 ) / W;
+    constexpr int Tail      = NumIns - ( NumChunks - 1 ) * W;
+    constexpr int RowLength = round_up ( NumIns, RowAlign );
+    constexpr int NumAccs   = round_up ( NumNeurons, RowAlign );
+    static_assert ( RowAlign % W == 0, "the rows should be padded to a multiple of the vector width" );
+    vec in[ NumChunks ];
+    for ( int c = 0; c < NumChunks - 1; ++c )
+        in[ c ] = Isa::load ( ibo_ + c * W );
+    in[ NumChunks - 1 ] = Isa::template load_partial<Tail> ( ibo_ + ( NumChunks - 1 ) * W );
+    alignas ( 64 ) float acc[ NumAccs ];
+    int n = 0;
+    for ( ; n < NumNeurons - 3; n += 4 ) {
+        float const * const w = inp_ + n * RowLength;
+        vec a0 = Isa::zero ( ), a1 = Isa::zero ( ), a2 = Isa::zero ( ), a3 = Isa::zero ( );
+        for ( int c = 0; c < NumChunks; ++c ) {
+            a0 = Isa::fmadd ( in[ c ], Isa::load_aligned ( w + c * W ), a0 );
+            a1 = Isa::fmadd ( in[ c ], Isa::load_aligned ( w + RowLength + c * W ), a1 );
+            a2 = Isa::fmadd ( in[ c ], Isa::load_aligned ( w + 2 * RowLength + c * W ), a2 );
+            a3 = Isa::fmadd ( in[ c ], Isa::load_aligned ( w + 3 * RowLength + c * W ), a3 );
+        }
+        acc[ n ]     = Isa::hsum ( a0 );
+        acc[ n + 1 ] = Isa::hsum ( a1 );
+        acc[ n + 2 ] = Isa::hsum ( a2 );
+        acc[ n + 3 ] = Isa::hsum ( a3 );
+    }
+    // Without a remainder, the (dead) loop would still be compiled, and warned about.
+    if constexpr ( NumNeurons % 4 != 0 ) {
+        for ( ; n < NumNeurons; ++n ) {
+            float const * const w = inp_ + n * RowLength;
+            vec a                 = Isa::zero ( );
+            for ( int c = 0; c < NumChunks; ++c )
+                a = Isa::fmadd ( in[ c ], Isa::load_aligned ( w + c * W ), a );
+            acc[ n ] = Isa::hsum ( a );
+        }
+    }
+    for ( ; n < NumAccs; ++n )
+        acc[ n ] = 0.0f;
+    triangle<Isa, Activation, NumIns, NumNeurons, RowAlign> ( ibo_, acc, tri_ );
+}
+
+// Feed-forward of a dense layer of NumOut neurons, fed by the NumIn values at in_, the outputs go to
+// out_. The weights are stored row after row, row n having length NumIn, plus its bias with Bias. A
+// GEMV, four rows at a time (sharing the loads of the inputs), the activation is applied to whole
+// vectors of outputs.
+template<typename Isa, typename Activation, int NumIn, int NumOut, bool Bias>
+SIMD_INLINE void dense ( float const * const in_, float * const out_, float const * const wgt_ ) noexcept {
+    using vec               = typename Isa::vec;
+    constexpr int W         = Isa::width;
+    constexpr int NumChunks = ( NumIn + W - 1 ) / W;
+    constexpr int Tail      = NumIn - ( NumChunks - 1 ) * W;
+    constexpr int Stride    = NumIn + Bias;
+    vec in[ NumChunks ];
+    for ( int c = 0; c < NumChunks - 1; ++c )
+        in[ c ] = Isa::load ( in_ + c * W );
+    in[ NumChunks - 1 ] = Isa::template load_partial<Tail> ( in_ + ( NumChunks - 1 ) * W );
+    alignas ( 64 ) float acc[ round_up ( NumOut, W ) ];
+    int n = 0;
+    for ( ; n < NumOut - 3; n += 4 ) {
+        float const * const w = wgt_ + n * Stride;
+        vec a0 = Isa::zero ( ), a1 = Isa::zero ( ), a2 = Isa::zero ( ), a3 = Isa::zero ( );
+        for ( int c = 0; c < NumChunks - 1; ++c ) {
+            a0 = Isa::fmadd ( in[ c ], Isa::load ( w + c * W ), a0 );
+            a1 = Isa::fmadd ( in[ c ], Isa::load ( w + Stride + c * W ), a1 );
+            a2 = Isa::fmadd ( in[ c ], Isa::load ( w + 2 * Stride + c * W ), a2 );
+            a3 = Isa::fmadd ( in[ c ], Isa::load ( w + 3 * Stride + c * W ), a3 );
+        }
+        constexpr int c = NumChunks - 1;
+        a0 = Isa::fmadd ( in[ c ], Isa::template load_partial<Tail> ( w + c * W ), a0 );
+        a1 = Isa::fmadd ( in[ c ], Isa::template load_partial<Tail> ( w + Stride + c * W ), a1 );
+        a2 = Isa::fmadd ( in[ c ], Isa::template load_partial<Tail> ( w + 2 * Stride + c * W ), a2 );
+        a3 = Isa::fmadd ( in[ c ], Isa::template load_partial<Tail> ( w + 3 * Stride + c * W ), a3 );
+        acc[ n ]     = Isa::hsum ( a0 ) + ( Bias ? w[ NumIn ] : 0.0f );
+        acc[ n + 1 ] = Isa::hsum ( a1 ) + ( Bias ? w[ Stride + NumIn ] : 0.0f );
+        acc[ n + 2 ] = Isa::hsum ( a2 ) + ( Bias ? w[ 2 * Stride + NumIn ] : 0.0f );
+        acc[ n + 3 ] = Isa::hsum ( a3 ) + ( Bias ? w[ 3 * Stride + NumIn ] : 0.0f );
+    }
+    if constexpr ( NumOut % 4 != 0 ) {
+        for ( ; n < NumOut; ++n ) {
+            float const * const w = wgt_ + n * Stride;
+            vec a                 = Isa::zero ( );
+            for ( int c = 0; c < NumChunks - 1; ++c )
+                a = Isa::fmadd ( in[ c ], Isa::load ( w + c * W ), a );
+            a        = Isa::fmadd ( in[ NumChunks - 1 ], Isa::template load_partial<Tail> ( w + ( NumChunks - 1 ) * W ), a );
+            acc[ n ] = Isa::hsum ( a ) + ( Bias ? w[ NumIn ] : 0.0f );
+        }
+    }
+    n = 0;
+    for ( ; n < NumOut - ( W - 1 ); n += W ) {
+        vec a = Isa::load_aligned ( acc + n );
+        Activation::template vector<Isa> ( a );
+        Isa::store ( out_ + n, a );
+    }
+    for ( ; n < NumOut; ++n )
+        out_[ n ] = Activation::scalar ( acc[ n ] );
+}
+
+// Feed-forward of a layered network, the layers (of Width, Widths... neurons) one after the other. The
+// first layer is fed by the NumIn values at offset In of the work area (the inputs and the bias), every
+// later one by the outputs of the layer before it (plus a bias of its own, part of its rows), the
+// outputs of a layer follow its inputs. The weights are stored layer after layer.
+template<typename Isa, typename Activation, int In, int NumIn, int Width, int... Widths>
+SIMD_INLINE void layered ( float * const ibo_, float const * const wgt_ ) noexcept {
+    constexpr bool Bias = In > 0;
+    dense<Isa, Activation, NumIn, Width, Bias> ( ibo_ + In, ibo_ + In + NumIn, wgt_ );
+    if constexpr ( sizeof...( Widths ) > 0 )
+        layered<Isa, Activation, In + NumIn, Width, Widths...> ( ibo_, wgt_ + Width * ( NumIn + Bias ) );
+}
+
+// acc_ += the inputs of vector v_ of the lanes times their weights, one weight broadcast to all
+// lanes (SharedWeights) or interleaved ones. No vector is passed by value or returned, the helper
+// is inlined into the kernel whatever the flags of the translation unit.
+template<typename Isa, bool SharedWeights, typename Weight>
+SIMD_INLINE void lane_fmadd ( typename Isa::vec & acc_, float const * const in_, Weight const * const w_, int const v_ ) noexcept {
+    constexpr int W = Isa::width;
+    if constexpr ( SharedWeights )
+        acc_ = Isa::fmadd ( Isa::load ( in_ + v_ * W ), Isa::broadcast ( to_float ( *w_ ) ), acc_ );
+    else
+        acc_ = Isa::fmadd ( Isa::load ( in_ + v_ * W ), Isa::load ( w_ + v_ * W ), acc_ );
+}
+
+// Feed-forward of Lanes cascades at once, the work area is interleaved, i.e. value i of lane l
+// lives at [ i * Lanes + l ]. Every instruction computes the same neuron for all lanes (the
+// activation included), two accumulators per vector hide the latency of the fma-chain. With
+// SharedWeights all lanes run the same network (a batch of inputs), the weights are then
+// broadcast, otherwise the weights are interleaved as well (a batch of networks).
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, int Lanes, bool SharedWeights, typename Weight>
+SIMD_INLINE void cascade_lanes ( float * const ibo_, Weight const * wgt_ ) noexcept {
+    using vec                 = typename Isa::vec;
+    constexpr int W           = Isa::width;
+    constexpr int V           = Lanes / W;
+    constexpr int WeightWidth = SharedWeights ? 1 : Lanes;
+    static_assert ( V * W == Lanes, "the number of lanes should be a multiple of the vector width" );
+    for ( int n = 0; n < NumNeurons; ++n ) {
+        vec acc0[ V ], acc1[ V ];
+        for ( int v = 0; v < V; ++v )
+            acc0[ v ] = acc1[ v ] = Isa::zero ( );
+        float const * in = ibo_;
+        int j            = 0;
+        for ( ; j < NumIns + n - 1; j += 2, in += 2 * Lanes, wgt_ += 2 * WeightWidth ) {
+            for ( int v = 0; v < V; ++v ) {
+                lane_fmadd<Isa, SharedWeights> ( acc0[ v ], in, wgt_, v );
+                lane_fmadd<Isa, SharedWeights> ( acc1[ v ], in + Lanes, wgt_ + WeightWidth, v );
+            }
+        }
+        if ( j < NumIns + n ) {
+            for ( int v = 0; v < V; ++v )
+                lane_fmadd<Isa, SharedWeights> ( acc0[ v ], in, wgt_, v );
+            wgt_ += WeightWidth;
+        }
+        float * const out = ibo_ + ( NumIns + n ) * Lanes;
+        for ( int v = 0; v < V; ++v ) {
+            vec a = Isa::add ( acc0[ v ], acc1[ v ] );
+            Activation::template vector<Isa> ( a );
+            Isa::store ( out + v * W, a );
+        }
+    }
+}
+
+// Feed-forward of a quantized cascade, rows of RowAlign aligned and padded 16- or 8-bit weights,
+// their integer dot products with the 16-bit fixed point activations act_ (the inputs filled in)
+// scaled back to float by scales_. The output of a neuron goes to the work area, and to act_,
+// clamped to [ -1, 1 ] and scaled by act_max_.
+template<typename Isa, typename Activation, int NumIns, int NumNeurons, int RowAlign, typename Weight>
+SIMD_INLINE void cascade_quantized ( float * const ibo_, std::int16_t * const act_, Weight const * wgt_,
+                                     float const * const scales_, float const act_max_ ) noexcept {
+    for ( int n = 0; n < NumNeurons; ++n ) {
+        int const length   = round_up ( NumIns + n, RowAlign );
+        float const out    = Activation::scalar ( Isa::dot ( act_, wgt_, length ) * scales_[ n ] );
+        float const c      = out < -1.0f ? -1.0f : out > 1.0f ? 1.0f : out;
+        ibo_[ NumIns + n ] = out;
+        act_[ NumIns + n ] = static_cast<std::int16_t> ( std::lrint ( c * act_max_ ) );
+        wgt_ += length;
+    }
+}
+
+SIMD_KERNELS_END
+
+} // namespace simd
@@ -31,9 +31,12 @@
 #include <cstring>
 
 #include <algorithm>
+#include <bit>
+#include <numeric>
 #include <sax/iostream.hpp>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "ring_span.hpp"
 
@@ -55,39 +58,422 @@ template<typename Popper, typename T, size_t N>
 
 #include <sax/uniform_int_distribution.hpp>
 
+#include "cycle_detector.hpp"
+#include "decision_cache.hpp"
 #include "fcc.hpp"
+#include "fcc_interleaved.hpp"
 #include "globals.hpp"
 #include "rng.hpp"
+#include "scheduler.hpp"
 
-struct Point {
-    char x, y;
+// A point of a field, its coordinates are (signed) Coordinate. The point is packed in (and aligned to)
+// a single word, comparisons are a single comparison of that word.
+template<typename Coordinate>
+struct alignas ( 2 * sizeof ( Coordinate ) ) BasicPoint {
 
-    [[nodiscard]] bool operator== ( Point const & rhs_ ) const noexcept { return rhs_.x == x and rhs_.y == y; }
-    [[nodiscard]] bool operator!= ( Point const & rhs_ ) const noexcept { return not operator== ( rhs_ ); }
+    using value_type = Coordinate;
+    using word_type  = std::conditional_t<1 == sizeof ( Coordinate ), std::uint16_t, std::uint32_t>;
+
+    Coordinate x, y;
+
+    [[nodiscard]] word_type word ( ) const noexcept { return std::bit_cast<word_type> ( *this ); }
+
+    [[nodiscard]] bool operator== ( BasicPoint const & rhs_ ) const noexcept { return rhs_.word ( ) == word ( ); }
+    [[nodiscard]] bool operator!= ( BasicPoint const & rhs_ ) const noexcept { return not operator== ( rhs_ ); }
+
+    [[nodiscard]] friend BasicPoint operator+ ( BasicPoint && p1_, BasicPoint const & p2_ ) noexcept {
+        p1_.x += p2_.x;
+        p1_.y += p2_.y;
+        return p1_;
+    }
+
+    [[nodiscard]] friend BasicPoint operator- ( BasicPoint const & p1_, BasicPoint const & p2_ ) noexcept {
+        return { static_cast<Coordinate> ( p1_.x - p2_.x ), static_cast<Coordinate> ( p1_.y - p2_.y ) };
+    }
 
     template<typename Stream>
-    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, Point const & p_ ) noexcept {
+    [[maybe_unused]] friend Stream & operator<< ( Stream & out_, BasicPoint const & p_ ) noexcept {
         out_ << '<' << ( int ) p_.x << ' ' << ( int ) p_.y << '>';
         return out_;
     }
 };
 
-[[nodiscard]] Point operator+ ( Point && p1_, Point const & p2_ ) noexcept {
-    p1_.x += p2_.x;
-    p1_.y += p2_.y;
-    return p1_;
-}
+// The point of a field of FieldSize, with 8-bit coordinates up to a size of 127 (the difference of two
+// points, a head and the food, needs to fit as well), 16-bit coordinates beyond.
+template<int FieldSize>
+using FieldPoint = BasicPoint<std::conditional_t<FieldSize <= 127, std::int8_t, std::int16_t>>;
 
-[[nodiscard]] Point operator- ( Point const & p1_, Point const & p2_ ) noexcept {
-    return { static_cast<char> ( p1_.x - p2_.x ), static_cast<char> ( p1_.y - p2_.y ) };
-}
-
-template<int B>
+template<typename Point, int B>
 [[nodiscard]] Point random_point ( ) noexcept {
-    auto idx = [] ( ) noexcept { return static_cast<char> ( sax::uniform_int_distribution<int>{ -B, B }( Rng::gen ( ) ) ); };
+    using Coordinate = typename Point::value_type;
+    auto idx         = [] ( ) noexcept {
+        return static_cast<Coordinate> ( sax::uniform_int_distribution<int>{ -B, B }( Rng::gen ( ) ) );
+    };
     return { idx ( ), idx ( ) };
 }
 
+// The cells of the field occupied by the snake, one bit per cell, by row, by column, by diagonal and
+// by anti-diagonal (a line holds the bit of its cells by x, or by y for a column). The nearest
+// occupied cell in any of the 8 directions is then a bit scan on a line. The free cells are kept as
+// well, as a permutation of all cells, the free ones first, plus its inverse, a cell is taken or given
+// back by a swap. The points are (and need to be) in range. The lines and the permutation live on
+// the heap, they grow with the field (quadratically, the permutation).
+template<int FieldSize>
+struct Occupancy {
+
+    static constexpr int FieldRadius  = FieldSize / 2;
+    static constexpr int NumWords     = ( FieldSize + 63 ) / 64;
+    static constexpr int NumDiagonals = 2 * FieldSize - 1;
+    static constexpr int NumCells     = FieldSize * FieldSize;
+
+    using Point      = FieldPoint<FieldSize>;
+    using Coordinate = typename Point::value_type;
+    using Line       = std::array<std::uint64_t, NumWords>;
+
+    // A cell (as an index into the permutation), 16 bits if they fit, that's up to 181 x 181 cells.
+    using Cell = std::conditional_t<NumCells <= 32'768, std::int16_t, std::int32_t>;
+
+    Occupancy ( ) :
+        m_rows ( FieldSize ), m_columns ( FieldSize ), m_diagonals ( NumDiagonals ), m_anti_diagonals ( NumDiagonals ),
+        m_free ( NumCells ), m_free_index ( NumCells ) {
+        clear ( );
+    }
+
+    // All cells free, the permutation is reset as well, so that an episode (its food) only depends on
+    // the seed of the rng.
+    void clear ( ) noexcept {
+        std::fill ( std::begin ( m_rows ), std::end ( m_rows ), Line{ } );
+        std::fill ( std::begin ( m_columns ), std::end ( m_columns ), Line{ } );
+        std::fill ( std::begin ( m_diagonals ), std::end ( m_diagonals ), Line{ } );
+        std::fill ( std::begin ( m_anti_diagonals ), std::end ( m_anti_diagonals ), Line{ } );
+        std::iota ( std::begin ( m_free ), std::end ( m_free ), Cell{ 0 } );
+        std::iota ( std::begin ( m_free_index ), std::end ( m_free_index ), Cell{ 0 } );
+        m_num_free = NumCells;
+    }
+
+    [[nodiscard]] bool test ( Point const & p_ ) const noexcept {
+        int const x = p_.x + FieldRadius;
+        return ( m_rows[ p_.y + FieldRadius ][ x >> 6 ] >> ( x & 63 ) ) & 1;
+    }
+
+    void set ( Point const & p_ ) noexcept {
+        int const x = p_.x + FieldRadius, y = p_.y + FieldRadius;
+        set ( m_rows[ y ], x );
+        set ( m_columns[ x ], y );
+        set ( m_diagonals[ x - y + FieldSize - 1 ], x );
+        set ( m_anti_diagonals[ x + y ], x );
+        take ( y * FieldSize + x );
+    }
+
+    void reset ( Point const & p_ ) noexcept {
+        int const x = p_.x + FieldRadius, y = p_.y + FieldRadius;
+        reset ( m_rows[ y ], x );
+        reset ( m_columns[ x ], y );
+        reset ( m_diagonals[ x - y + FieldSize - 1 ], x );
+        reset ( m_anti_diagonals[ x + y ], x );
+        give ( y * FieldSize + x );
+    }
+
+    [[nodiscard]] int num_free ( ) const noexcept { return m_num_free; }
+
+    // A free cell, uniformly drawn, there needs to be one.
+    [[nodiscard]] Point random_free ( ) const noexcept {
+        int const c = m_free[ sax::uniform_int_distribution<int>{ 0, m_num_free - 1 }( Rng::gen ( ) ) ];
+        return { static_cast<Coordinate> ( c % FieldSize - FieldRadius ), static_cast<Coordinate> ( c / FieldSize - FieldRadius ) };
+    }
+
+    // The distances (in steps along the line) from p_ to the nearest occupied cell, north, east, south
+    // and west of it, or 0 if there's none.
+    [[nodiscard]] int north ( Point const & p_ ) const noexcept {
+        return above ( m_columns[ p_.x + FieldRadius ], p_.y + FieldRadius );
+    }
+    [[nodiscard]] int east ( Point const & p_ ) const noexcept {
+        return above ( m_rows[ p_.y + FieldRadius ], p_.x + FieldRadius );
+    }
+    [[nodiscard]] int south ( Point const & p_ ) const noexcept {
+        return below ( m_columns[ p_.x + FieldRadius ], p_.y + FieldRadius );
+    }
+    [[nodiscard]] int west ( Point const & p_ ) const noexcept {
+        return below ( m_rows[ p_.y + FieldRadius ], p_.x + FieldRadius );
+    }
+
+    // As north, the diagonal directions.
+    [[nodiscard]] int north_east ( Point const & p_ ) const noexcept { return above ( diagonal ( p_ ), p_.x + FieldRadius ); }
+    [[nodiscard]] int south_east ( Point const & p_ ) const noexcept { return above ( anti_diagonal ( p_ ), p_.x + FieldRadius ); }
+    [[nodiscard]] int south_west ( Point const & p_ ) const noexcept { return below ( diagonal ( p_ ), p_.x + FieldRadius ); }
+    [[nodiscard]] int north_west ( Point const & p_ ) const noexcept { return below ( anti_diagonal ( p_ ), p_.x + FieldRadius ); }
+
+    private:
+    [[nodiscard]] Line const & diagonal ( Point const & p_ ) const noexcept { return m_diagonals[ p_.x - p_.y + FieldSize - 1 ]; }
+    [[nodiscard]] Line const & anti_diagonal ( Point const & p_ ) const noexcept {
+        return m_anti_diagonals[ p_.x + p_.y + 2 * FieldRadius ];
+    }
+
+    // Swap the (free) cell c_ with the last free one, and drop it.
+    void take ( int const c_ ) noexcept {
+        Cell const i = m_free_index[ c_ ], last = m_free[ --m_num_free ];
+        m_free[ i ] = last, m_free_index[ last ] = i;
+        m_free[ m_num_free ] = static_cast<Cell> ( c_ ), m_free_index[ c_ ] = static_cast<Cell> ( m_num_free );
+    }
+
+    // Swap the (taken) cell c_ with the first taken one, and add it.
+    void give ( int const c_ ) noexcept {
+        Cell const i = m_free_index[ c_ ], first = m_free[ m_num_free ];
+        m_free[ i ] = first, m_free_index[ first ] = i;
+        m_free[ m_num_free ] = static_cast<Cell> ( c_ ), m_free_index[ c_ ] = static_cast<Cell> ( m_num_free++ );
+    }
+
+    static void set ( Line & l_, int const i_ ) noexcept { l_[ i_ >> 6 ] |= std::uint64_t{ 1 } << ( i_ & 63 ); }
+    static void reset ( Line & l_, int const i_ ) noexcept { l_[ i_ >> 6 ] &= ~( std::uint64_t{ 1 } << ( i_ & 63 ) ); }
+
+    // The distance from bit i_ to the nearest set bit above it, or 0 if there's none.
+    [[nodiscard]] static int above ( Line const & l_, int const i_ ) noexcept {
+        int const j     = i_ + 1;
+        int w           = j >> 6;
+        std::uint64_t m = w < NumWords ? l_[ w ] & ( ~std::uint64_t{ 0 } << ( j & 63 ) ) : 0;
+        while ( not m and ++w < NumWords )
+            m = l_[ w ];
+        return m ? ( w << 6 ) + std::countr_zero ( m ) - i_ : 0;
+    }
+
+    // The distance from bit i_ to the nearest set bit below it, or 0 if there's none.
+    [[nodiscard]] static int below ( Line const & l_, int const i_ ) noexcept {
+        int w           = i_ >> 6;
+        std::uint64_t m = l_[ w ] & ( ( std::uint64_t{ 1 } << ( i_ & 63 ) ) - 1 );
+        while ( not m and w > 0 )
+            m = l_[ --w ];
+        return m ? i_ - ( w << 6 ) - 63 + std::countl_zero ( m ) : 0;
+    }
+
+    std::vector<Line> m_rows, m_columns, m_diagonals, m_anti_diagonals;
+    std::vector<Cell> m_free, m_free_index;
+    int m_num_free = NumCells;
+};
+
+// The sensors of the observation, of Lanes snakes at once, SnakeSpace is a single lane, SnakeBatch has
+// Lanes of them. Each sensor writes all of its Size inputs (activations) for all lanes, input i of
+// lane l at d_[ i * Lanes + l ] (d_[ i ] for a single lane). The sensors read the snakes through a
+// view, which gives, per lane l, head_x, head_y, food_x, food_y, direction (0 to 3, clockwise from
+// north), energy and occupancy. The loops over the lanes are straight (branch-free), but for the body
+// sensors, which scan the occupancy of each lane.
+template<int FieldSize, int Lanes>
+struct Sensors {
+
+    static constexpr int FieldRadius = FieldSize / 2;
+
+    using Point      = FieldPoint<FieldSize>;
+    using Coordinate = typename Point::value_type;
+    using pointer    = float *;
+
+    // The reciprocals 1 / i (and 0 for 0) of all distances on the field, the diagonal distances to a
+    // wall go up to 2 * FieldSize - 1.
+    [[nodiscard]] static constexpr std::array<float, 2 * FieldSize> make_reciprocals ( ) noexcept {
+        std::array<float, 2 * FieldSize> r{ };
+        for ( int i = 1; i < 2 * FieldSize; ++i )
+            r[ i ] = 1.0f / i;
+        return r;
+    }
+
+    static constexpr std::array<float, 2 * FieldSize> Reciprocal = make_reciprocals ( );
+
+    // 1 / i_, and 0 for 0, from the table for a single lane, the lanes of a batch divide, without a
+    // table (a gather) they vectorize. Either way the values are the same.
+    [[nodiscard]] static float reciprocal ( int const i_ ) noexcept {
+        if constexpr ( 1 == Lanes )
+            return Reciprocal[ i_ ];
+        else
+            return i_ ? 1.0f / static_cast<float> ( i_ ) : 0.0f;
+    }
+
+    // Distances to the walls.
+    struct Wall4 {
+        static constexpr int Size = 4;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int l = 0; l < Lanes; ++l ) {
+                int const x = v_.head_x ( l ), y = v_.head_y ( l );
+                d_[ l ]             = reciprocal ( FieldRadius - y + 1 );
+                d_[ Lanes + l ]     = reciprocal ( FieldRadius - x + 1 );
+                d_[ 2 * Lanes + l ] = reciprocal ( FieldRadius + y + 1 );
+                d_[ 3 * Lanes + l ] = reciprocal ( FieldRadius + x + 1 );
+            }
+        }
+    };
+
+    // As Wall4, clockwise from north, the diagonal distances count double.
+    struct Wall8 {
+        static constexpr int Size = 8;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int l = 0; l < Lanes; ++l ) {
+                int const n = FieldRadius - v_.head_y ( l ), e = FieldRadius - v_.head_x ( l );
+                int const s = FieldRadius + v_.head_y ( l ), w = FieldRadius + v_.head_x ( l );
+                d_[ l ]             = reciprocal ( n + 1 );
+                d_[ Lanes + l ]     = reciprocal ( 2 * std::min ( e, n ) + 1 );
+                d_[ 2 * Lanes + l ] = reciprocal ( e + 1 );
+                d_[ 3 * Lanes + l ] = reciprocal ( 2 * std::min ( e, s ) + 1 );
+                d_[ 4 * Lanes + l ] = reciprocal ( s + 1 );
+                d_[ 5 * Lanes + l ] = reciprocal ( 2 * std::min ( w, s ) + 1 );
+                d_[ 6 * Lanes + l ] = reciprocal ( w + 1 );
+                d_[ 7 * Lanes + l ] = reciprocal ( 2 * std::min ( w, n ) + 1 );
+            }
+        }
+    };
+
+    // Distance to the food, if it's in line with the head, the direction it's in (north, east, south,
+    // west), the other inputs are zero. In line, the distance is the larger of the coordinate distances.
+    struct Food4 {
+        static constexpr int Size = 4;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            // A single lane branches to the one non-zero sensor (if any), the lanes of a batch select.
+            if constexpr ( 1 == Lanes ) {
+                int const x = v_.head_x ( 0 ) - v_.food_x ( 0 ), y = v_.head_y ( 0 ) - v_.food_y ( 0 );
+                d_[ 0 ] = d_[ 1 ] = d_[ 2 ] = d_[ 3 ] = 0.0f;
+                if ( 0 == x )
+                    d_[ y < 0 ? 0 : 2 ] = Reciprocal[ std::abs ( y ) ];
+                else if ( 0 == y )
+                    d_[ x < 0 ? 1 : 3 ] = Reciprocal[ std::abs ( x ) ];
+                return;
+            }
+            for ( int l = 0; l < Lanes; ++l ) {
+                int const x = v_.head_x ( l ) - v_.food_x ( l ), y = v_.head_y ( l ) - v_.food_y ( l );
+                float const r       = reciprocal ( std::max ( std::abs ( x ), std::abs ( y ) ) );
+                d_[ l ]             = 0 == x and y < 0 ? r : 0.0f;
+                d_[ Lanes + l ]     = 0 == y and x < 0 ? r : 0.0f;
+                d_[ 2 * Lanes + l ] = 0 == x and y >= 0 ? r : 0.0f;
+                d_[ 3 * Lanes + l ] = 0 == y and x > 0 ? r : 0.0f;
+            }
+        }
+    };
+
+    // As Food4, clockwise from north, the diagonal distances are halved.
+    struct Food8 {
+        static constexpr int Size = 8;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            // As Food4, a single lane branches.
+            if constexpr ( 1 == Lanes ) {
+                int const x = v_.head_x ( 0 ) - v_.food_x ( 0 ), y = v_.head_y ( 0 ) - v_.food_y ( 0 );
+                std::fill_n ( d_, Size, 0.0f );
+                if ( 0 == x )
+                    d_[ y < 0 ? 0 : 4 ] = Reciprocal[ std::abs ( y ) ];
+                else if ( x == y )
+                    d_[ y < 0 ? 1 : 5 ] = 0.5f * Reciprocal[ std::abs ( y ) ];
+                else if ( 0 == y )
+                    d_[ x < 0 ? 2 : 6 ] = Reciprocal[ std::abs ( x ) ];
+                else if ( x == -y )
+                    d_[ x < 0 ? 3 : 7 ] = 0.5f * Reciprocal[ std::abs ( x ) ];
+                return;
+            }
+            for ( int l = 0; l < Lanes; ++l ) {
+                int const x = v_.head_x ( l ) - v_.food_x ( l ), y = v_.head_y ( l ) - v_.food_y ( l );
+                float const r       = reciprocal ( std::max ( std::abs ( x ), std::abs ( y ) ) ), h = 0.5f * r;
+                bool const diagonal = 0 != x and x == y, anti_diagonal = 0 != x and x == -y;
+                d_[ l ]             = 0 == x and y < 0 ? r : 0.0f;
+                d_[ Lanes + l ]     = diagonal and y < 0 ? h : 0.0f;
+                d_[ 2 * Lanes + l ] = 0 == y and x < 0 ? r : 0.0f;
+                d_[ 3 * Lanes + l ] = anti_diagonal and x < 0 ? h : 0.0f;
+                d_[ 4 * Lanes + l ] = 0 == x and y >= 0 ? r : 0.0f;
+                d_[ 5 * Lanes + l ] = diagonal and y > 0 ? h : 0.0f;
+                d_[ 6 * Lanes + l ] = 0 == y and x > 0 ? r : 0.0f;
+                d_[ 7 * Lanes + l ] = anti_diagonal and x > 0 ? h : 0.0f;
+            }
+        }
+    };
+
+    // Distances to the nearest body segment in each direction (zero if there's none), by the occupancy.
+    struct Body4 {
+        static constexpr int Size = 4;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int l = 0; l < Lanes; ++l ) {
+                Point const h{ static_cast<Coordinate> ( v_.head_x ( l ) ), static_cast<Coordinate> ( v_.head_y ( l ) ) };
+                Occupancy<FieldSize> const & o = v_.occupancy ( l );
+                d_[ l ]                        = reciprocal ( o.north ( h ) );
+                d_[ Lanes + l ]                = reciprocal ( o.east ( h ) );
+                d_[ 2 * Lanes + l ]            = reciprocal ( o.south ( h ) );
+                d_[ 3 * Lanes + l ]            = reciprocal ( o.west ( h ) );
+            }
+        }
+    };
+
+    // As Body4, clockwise from north, the diagonal distances are halved.
+    struct Body8 {
+        static constexpr int Size = 8;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int l = 0; l < Lanes; ++l ) {
+                Point const h{ static_cast<Coordinate> ( v_.head_x ( l ) ), static_cast<Coordinate> ( v_.head_y ( l ) ) };
+                Occupancy<FieldSize> const & o = v_.occupancy ( l );
+                d_[ l ]                        = reciprocal ( o.north ( h ) );
+                d_[ Lanes + l ]                = 0.5f * reciprocal ( o.north_east ( h ) );
+                d_[ 2 * Lanes + l ]            = reciprocal ( o.east ( h ) );
+                d_[ 3 * Lanes + l ]            = 0.5f * reciprocal ( o.south_east ( h ) );
+                d_[ 4 * Lanes + l ]            = reciprocal ( o.south ( h ) );
+                d_[ 5 * Lanes + l ]            = 0.5f * reciprocal ( o.south_west ( h ) );
+                d_[ 6 * Lanes + l ]            = reciprocal ( o.west ( h ) );
+                d_[ 7 * Lanes + l ]            = 0.5f * reciprocal ( o.north_west ( h ) );
+            }
+        }
+    };
+
+    // The current direction, as a (north, east) vector.
+    struct Direction2 {
+        static constexpr int Size = 2;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int l = 0; l < Lanes; ++l ) {
+                int const d     = v_.direction ( l );
+                d_[ l ]         = static_cast<float> ( ( 0 == d ) - ( 2 == d ) );
+                d_[ Lanes + l ] = static_cast<float> ( ( 1 == d ) - ( 3 == d ) );
+            }
+        }
+    };
+
+    // The current direction, one-hot.
+    struct Direction4 {
+        static constexpr int Size = 4;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int i = 0; i < Size; ++i )
+                for ( int l = 0; l < Lanes; ++l )
+                    d_[ i * Lanes + l ] = static_cast<float> ( i == v_.direction ( l ) );
+        }
+    };
+
+    struct Energy1 {
+        static constexpr int Size = 1;
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            for ( int l = 0; l < Lanes; ++l )
+                d_[ l ] = 1.0f / ( 1.0f + static_cast<float> ( v_.energy ( l ) ) );
+        }
+    };
+
+    // An encoder writes the observation as the (compile-time) list of its sensors, one after the other,
+    // in one pass.
+    template<typename... Sensor>
+    struct Encoder {
+        static constexpr int Size = ( Sensor::Size + ... );
+        template<typename View>
+        static void write ( View const & v_, pointer d_ ) noexcept {
+            ( ( Sensor::write ( v_, d_ ), d_ += Sensor::Size * Lanes ), ... );
+        }
+    };
+
+    using Encoder15 = Encoder<Wall4, Food4, Body4, Direction2, Energy1>;
+    using Encoder16 = Encoder<Wall4, Food4, Body4, Direction4>;
+    using Encoder17 = Encoder<Wall4, Food4, Body4, Direction4, Energy1>;
+    using Encoder27 = Encoder<Wall8, Food8, Body8, Direction2, Energy1>;
+
+    // The encoder of the observation, by the number of inputs of the brains.
+    template<int NumInput>
+    using TheEncoder = std::conditional_t<
+        15 == NumInput, Encoder15,
+        std::conditional_t<16 == NumInput, Encoder16, std::conditional_t<27 == NumInput, Encoder27, Encoder17>>>;
+};
+
 template<int FieldSize, int NumInput, int NumNeurons, int NumOutput>
 struct SnakeSpace {
 
@@ -95,43 +481,67 @@ struct SnakeSpace {
 
     static constexpr int FieldRadius = FieldSize / 2;
 
+    // A snake can fill the field, the body holds the head of its fatal move as well (see move).
+    static constexpr int BodyCapacity = FieldSize * FieldSize + 1;
+
     enum class MoveDirection : int { no, ea, so, we };
 
-    using SnakeBody = nonstd::ring_span<Point, nonstd::null_popper<Point>>;
+    using Point      = FieldPoint<FieldSize>;
+    using Coordinate = typename Point::value_type;
+    using SnakeBody  = nonstd::ring_span<Point, nonstd::null_popper<Point>>;
 
     using pointer         = float *;
     using const_pointer   = float const *;
     using reference       = float &;
     using const_reference = float const &;
 
-    using TheBrain = FullyConnectedNeuralNetwork<NumInput, NumNeurons, NumOutput>;
-    using WorkArea = InputBiasOutput<NumInput, NumNeurons, NumOutput>;
+    // The work area of a brain, its layout is up to the brain.
+    template<typename Brain>
+    using WorkArea = typename Brain::ibo_type;
+
+    static constexpr int NumEpisodes = 3;
+
+    // The decisions of a brain during run are memoized (in a DecisionCache per thread), or not.
+    static inline bool memoize = false;
+
+    using Cache = DecisionCache<MoveDirection>;
+
+    // An episode ends as soon as the state of the snake repeats (it's circling without eating and
+    // would do so until its energy runs out), or not. The state is the body (the head and the
+    // direction included), the food can't change without the snake eating. It's exact for an encoder
+    // without the energy sensor, with it a circling brain is assumed not to break its cycle on its
+    // (slowly) dropping energy.
+    static inline bool detect_cycles = false;
+
+    using Cycles = CycleDetector<>;
+
+    // The steps of the move directions, and the link of the head (see segment_key).
+    static constexpr Point Step[ 4 ]{ { +0, +1 }, { +1, +0 }, { +0, -1 }, { -1, +0 } };
+    static constexpr int Head = 4;
 
-    SnakeSpace ( ) noexcept : m_snake_body{ make_ring_span<nonstd::null_popper<Point>> ( m_snake_body_data ) } {}
+    SnakeSpace ( ) :
+        m_snake_body_data ( BodyCapacity ), m_snake_body{ std::begin ( m_snake_body_data ), std::end ( m_snake_body_data ) },
+        m_links ( FieldSize * FieldSize ) {}
 
     [[nodiscard]] inline bool in_range ( Point const & p_ ) const noexcept {
         return p_.x >= -FieldRadius and p_.y >= -FieldRadius and p_.x <= FieldRadius and p_.y <= FieldRadius;
     }
 
-    [[nodiscard]] inline bool snake_body_contains ( Point const & p_ ) const noexcept {
-        return std::find ( std::cbegin ( m_snake_body ), std::cend ( m_snake_body ), p_ ) != std::cend ( m_snake_body );
-    }
+    // The point needs to be in range.
+    [[nodiscard]] inline bool snake_body_contains ( Point const & p_ ) const noexcept { return m_occupancy.test ( p_ ); }
 
-    // Returns whether the head is at the same position as any of the body parts.
-    [[nodiscard]] inline bool snake_body_not_crossing ( ) const noexcept {
-        return std::find ( std::cbegin ( m_snake_body ) + 1, std::cend ( m_snake_body ), m_snake_body.front ( ) ) ==
-               std::cend ( m_snake_body );
-    }
+    // Returns whether the head is at the same position as any of the body parts, the (new) head is in
+    // range and not marked in the occupancy yet (see move).
+    [[nodiscard]] inline bool snake_body_not_crossing ( ) const noexcept { return not m_occupancy.test ( m_snake_body.front ( ) ); }
 
     [[nodiscard]] inline bool valid_empty_point ( Point const & p_ ) const noexcept {
         return in_range ( p_ ) and not snake_body_contains ( p_ );
     }
 
+    // A uniformly drawn empty cell, if the snake fills the field the food stays where it is (on the head).
     void random_food ( ) noexcept {
-        Point f = random_point<FieldRadius> ( );
-        while ( snake_body_contains ( f ) )
-            f = random_point<FieldRadius> ( );
-        m_food = f;
+        if ( m_occupancy.num_free ( ) )
+            m_food = m_occupancy.random_free ( );
     }
 
     void init_run ( ) noexcept {
@@ -139,10 +549,53 @@ struct SnakeSpace {
         m_energy     = 100;
         m_direction  = static_cast<MoveDirection> ( sax::uniform_int_distribution<int>{ 0, 3 }( Rng::gen ( ) ) );
         m_snake_body = SnakeBody{ std::begin ( m_snake_body_data ), std::end ( m_snake_body_data ) };
-        m_snake_body.emplace_front ( random_point<FieldRadius - 6> ( ) ); // the new tail.
+        m_snake_body.emplace_front ( random_point<Point, FieldRadius - 6> ( ) ); // the new tail.
         m_snake_body.emplace_front ( extend_head ( ) );
         m_snake_body.emplace_front ( extend_head ( ) ); // the new head.
+        m_occupancy.clear ( );
+        for ( Point const & p : m_snake_body )
+            m_occupancy.set ( p );
         random_food ( );
+        if ( detect_cycles ) {
+            int const d = static_cast<int> ( m_direction );
+            m_body_key  = segment_key ( m_snake_body.front ( ), Head );
+            for ( auto it = std::cbegin ( m_snake_body ) + 1; it != std::cend ( m_snake_body ); ++it ) {
+                m_links[ cell ( *it ) ] = static_cast<std::uint8_t> ( d );
+                m_body_key ^= segment_key ( *it, d );
+            }
+            m_cycles.next_epoch ( );
+            ( void ) m_cycles.repeated ( m_body_key );
+        }
+    }
+
+    [[nodiscard]] static int cell ( Point const & p_ ) noexcept { return ( p_.y + FieldRadius ) * FieldSize + p_.x + FieldRadius; }
+
+    // The Zobrist key of a body segment, of its cell and its link, the direction of the move the snake
+    // made from it (Head for the head), the keys of all segments together determine the body.
+    [[nodiscard]] static std::uint64_t segment_key ( Point const & p_, int const link_ ) noexcept {
+        return Cycles::zobrist ( static_cast<std::uint64_t> ( cell ( p_ ) * 5 + link_ ) );
+    }
+
+    // Updates the key of the body to the move just made (before the tail moves), on a repeat the snake
+    // starves, its next move is its last (as it would have been), when it ate a new epoch starts. The
+    // links are kept per cell, which saves walking the ring.
+    void track_cycle ( ) noexcept {
+        Point const & head = m_snake_body.front ( );
+        int const d        = static_cast<int> ( m_direction );
+        Point const neck   = head - Step[ d ];
+        m_links[ cell ( neck ) ] = static_cast<std::uint8_t> ( d );
+        m_body_key ^= segment_key ( neck, Head ) ^ segment_key ( neck, d ) ^ segment_key ( head, Head );
+        if ( head == m_food ) {
+            m_cycles.next_epoch ( );
+            ( void ) m_cycles.repeated ( m_body_key );
+            return;
+        }
+        Point const & tail = m_snake_body.back ( );
+        m_body_key ^= segment_key ( tail, m_links[ cell ( tail ) ] );
+        if ( m_cycles.repeated ( m_body_key ) ) {
+            Cycles::add ( m_energy - 1 );
+            m_energy = 1;
+        }
     }
 
     [[nodiscard]] inline Point extend_head ( ) const noexcept {
@@ -159,13 +612,18 @@ struct SnakeSpace {
         return m_energy and in_range ( m_snake_body.front ( ) ) and snake_body_not_crossing ( );
     }
 
-    // Returns the dead(false)/alive(true) status.
+    // Returns the dead(false)/alive(true) status. The tail moves after the head, moving the head onto
+    // the tail is deadly.
     bool move ( ) noexcept {
         ++m_move_count;
         --m_energy;
         m_snake_body.emplace_front ( extend_head ( ) );
         if ( is_not_dead ( ) ) {
+            m_occupancy.set ( m_snake_body.front ( ) );
+            if ( detect_cycles )
+                track_cycle ( );
             if ( m_snake_body.front ( ) != m_food ) {
+                m_occupancy.reset ( m_snake_body.back ( ) );
                 m_snake_body.pop_back ( );
                 return true;
             }
@@ -192,9 +650,11 @@ struct SnakeSpace {
         m_snake_body.emplace_front ( extend_head ( ) );
         m_changes.new_head = m_snake_body.front ( );
         if ( is_not_dead ( ) ) {
+            m_occupancy.set ( m_snake_body.front ( ) );
             if ( m_snake_body.front ( ) != m_food ) {
                 m_changes.has_eaten = false;
                 m_changes.old_tail  = m_snake_body.back ( );
+                m_occupancy.reset ( m_snake_body.back ( ) );
                 m_snake_body.pop_back ( );
                 return true;
             }
@@ -244,116 +704,180 @@ struct SnakeSpace {
     }
 
     // Return the fitness of the network.
-    [[nodiscard]] float run ( TheBrain * const brain_, int const age_ ) noexcept {
-        static thread_local WorkArea work_area;
-        int const s = 3;
-        int r       = 0;
-        for ( int i = 0; i < s; ++i ) {
+    template<typename Brain>
+    [[nodiscard]] float run ( Brain * const brain_, int const age_ ) noexcept {
+        static thread_local WorkArea<Brain> work_area;
+        static thread_local Cache cache;
+        int r = 0;
+        for ( int i = 0; i < NumEpisodes; ++i ) {
+            init_run ( );
+            while ( move ( ) ) {                                       // As long as not dead.
+                m_direction = think_memoized ( brain_, work_area, cache ); // Observe, run the data and decide where to go,
+            }                                                              // and change direction.
+            r += m_snake_body.size ( );
+            m_num_moves += m_move_count;
+        }
+        if ( memoize )
+            cache.invalidate ( ); // The next run is another brain, or this one changed.
+        return static_cast<float> ( r ) / static_cast<float> ( NumEpisodes );
+    }
+
+    // Return the fitness of the network, as run, but every decision is taken by other_ as well (on the
+    // same observation). Adds the number of decisions, and the number of those other_ takes differently,
+    // to num_decisions_ and num_changed_.
+    template<typename Brain, typename Other>
+    [[nodiscard]] float run_compare ( Brain * const brain_, Other * const other_, std::int64_t & num_decisions_,
+                                      std::int64_t & num_changed_ ) noexcept {
+        static thread_local WorkArea<Brain> work_area;
+        static thread_local WorkArea<Other> other_work_area;
+        int r = 0;
+        for ( int i = 0; i < NumEpisodes; ++i ) {
+            init_run ( );
+            while ( move ( ) ) {
+                MoveDirection const d = decide_direction ( think ( brain_, work_area ) );
+                num_changed_ += d != decide_direction ( think ( other_, other_work_area ) );
+                ++num_decisions_;
+                m_direction = d;
+            }
+            r += m_snake_body.size ( );
+            m_num_moves += m_move_count;
+        }
+        return static_cast<float> ( r ) / static_cast<float> ( NumEpisodes );
+    }
+
+    // Write the fitness of each of the networks of the batch, every lane plays its episodes in its
+    // own snake space, all lanes move in lockstep and share one feed-forward per step.
+    template<typename BrainBatch>
+    static void run_interleaved ( BrainBatch const & brain_, SnakeSpace * const spaces_, float * const fitness_ ) noexcept {
+        static thread_local typename BrainBatch::ibo_type work_area;
+        constexpr int Lanes = BrainBatch::NumLanes;
+        int r[ Lanes ]{ };
+        play_lockstep<Lanes> ( spaces_, NumEpisodes, work_area, [ & ] ( ) noexcept { brain_.feed_forward ( work_area ); }, r );
+        for ( int l = 0; l < Lanes; ++l )
+            fitness_[ l ] = static_cast<float> ( r[ l ] ) / static_cast<float> ( NumEpisodes );
+    }
+
+    // Return the fitness of the network, all Episodes are played in lockstep, one per snake space,
+    // every step is a single feed-forward of the batch of all episodes (dead ones are masked out).
+    template<int Episodes = NumLanes, typename Brain>
+    [[nodiscard]] static float run_lockstep ( Brain * const brain_, SnakeSpace * const spaces_ ) noexcept {
+        static thread_local InputBiasOutputBatch<NumInput, NumNeurons, NumOutput, Episodes> work_area;
+        int r[ Episodes ]{ };
+        play_lockstep<Episodes> ( spaces_, 1, work_area, [ & ] ( ) noexcept { brain_->feed_forward_batch ( work_area ); }, r );
+        return static_cast<float> ( std::accumulate ( r, r + Episodes, 0 ) ) / static_cast<float> ( Episodes );
+    }
+
+    // Return (co_return) the fitness of the network, as run, but as a coroutine that suspends on every
+    // inference. The observation is written to lane_ of the batch work area, the scheduler runs the
+    // brains of all lanes at once and resumes the run, which then reads the output of its lane.
+    template<typename BatchWorkArea>
+    [[nodiscard]] Run run_scheduled ( BatchWorkArea & work_area_, int const lane_ ) noexcept {
+        float input[ NumInput ], output[ NumOutput ];
+        int r = 0;
+        for ( int i = 0; i < NumEpisodes; ++i ) {
             init_run ( );
-            while ( move ( ) ) {                        // As long as not dead.
-                gather_input_17 ( work_area.data ( ) ); // Observe the environment.
-                m_direction =
-                    decide_direction ( brain_->feed_forward ( work_area.data ( ) ) ); // Run the data and decide where to go,
-            }                                                                         // and change direction.
+            while ( move ( ) ) {        // As long as not dead.
+                gather_input ( input ); // Observe the environment,
+                work_area_.input ( lane_, input );
+                co_await Inference{ }; // wait for the brains to run,
+                work_area_.output ( lane_, output );
+                m_direction = decide_direction ( output ); // and decide where to go.
+            }
             r += m_snake_body.size ( );
+            m_num_moves += m_move_count;
         }
-        return static_cast<float> ( r ) / static_cast<float> ( s );
+        co_return static_cast<float> ( r ) / static_cast<float> ( NumEpisodes );
     }
 
-    void run_display ( TheBrain * const brain_ ) noexcept {
-        static thread_local WorkArea work_area;
+    template<typename Brain>
+    void run_display ( Brain * const brain_ ) noexcept {
+        static thread_local WorkArea<Brain> work_area;
         init_run ( );
         set_cursor_position ( 0, 0 );
         print ( );
-        while ( move_display ( ) ) {                // As long as not dead.
-            gather_input_17 ( work_area.data ( ) ); // Observe the environment.
-            m_direction = decide_direction (
-                brain_->feed_forward ( work_area.data ( ) ) ); // Run the data and decide where to go, and change direction.
+        while ( move_display ( ) ) {                                       // As long as not dead.
+            m_direction = decide_direction ( think ( brain_, work_area ) ); // Observe, run the data and decide where to go,
+                                                                            // and change direction.
             print_update ( );
             sleep_for_milliseconds ( 25 );
         }
     }
 
     private:
-    // Manhattan distance (activation) between points.
-    [[nodiscard]] static std::tuple<int, float> distance_point_to_point_8 ( Point const & p0_, Point const & p1_ ) noexcept {
-        Point const s = p0_ - p1_;
-        if ( 0 == s.x )
-            return s.y < 0 ? std::tuple<int, float> ( 0, 1.0f / -s.y ) : std::tuple<int, float> ( 4, 1.0f / +s.y );
-        if ( s.x == s.y )
-            return s.y < 0 ? std::tuple<int, float> ( 1, 0.5f / -s.y ) : std::tuple<int, float> ( 5, 0.5f / +s.y );
-        if ( 0 == s.y )
-            return s.x < 0 ? std::tuple<int, float> ( 2, 1.0f / -s.x ) : std::tuple<int, float> ( 6, 1.0f / +s.x );
-        if ( s.x == -s.y )
-            return s.x < 0 ? std::tuple<int, float> ( 3, 0.5f / -s.x ) : std::tuple<int, float> ( 7, 0.5f / +s.x );
-        return std::tuple<int, float> ( 0, 0.0f ); // Default is north, but set to zero, which avoids any checking.
-    }
-
-    // Manhattan distance (activation) between points.
-    [[nodiscard]] static std::tuple<int, float> distance_point_to_point_4 ( Point const & p0_, Point const & p1_ ) noexcept {
-        Point const s = p0_ - p1_;
-        if ( 0 == s.x )
-            return s.y < 0 ? std::tuple<int, float> ( 0, 1.0f / -s.y ) : std::tuple<int, float> ( 2, 1.0f / +s.y );
-        if ( 0 == s.y )
-            return s.x < 0 ? std::tuple<int, float> ( 1, 1.0f / -s.x ) : std::tuple<int, float> ( 3, 1.0f / +s.x );
-        return std::tuple<int, float> ( 0, 0.0f ); // Default is north, but set to zero, which avoids any checking.
-    }
-
-    // Input (activation) for distances to wall.
-    void distances_to_wall_8 ( pointer data_ ) const noexcept {
-        Point const & head = m_snake_body.front ( );
-        data_[ 0 ]         = 1.0f / ( FieldRadius - head.y + 1 );
-        data_[ 1 ]         = 1.0f / ( 2 * std::min ( FieldRadius - head.x, FieldRadius - head.y ) + 1 );
-        data_[ 2 ]         = 1.0f / ( FieldRadius - head.x + 1 );
-        data_[ 3 ]         = 1.0f / ( 2 * std::min ( FieldRadius - head.x, FieldRadius + head.y ) + 1 );
-        data_[ 4 ]         = 1.0f / ( FieldRadius + head.y + 1 );
-        data_[ 5 ]         = 1.0f / ( 2 * std::min ( FieldRadius + head.x, FieldRadius + head.y ) + 1 );
-        data_[ 6 ]         = 1.0f / ( FieldRadius + head.x + 1 );
-        data_[ 7 ]         = 1.0f / ( 2 * std::min ( FieldRadius + head.x, FieldRadius - head.y ) + 1 );
-    }
-
-    // Input (activation) for distances to wall.
-    void distances_to_wall_4 ( pointer data_ ) const noexcept {
-        Point const & head = m_snake_body.front ( );
-        data_[ 0 ]         = 1.0f / ( FieldRadius - head.y + 1 );
-        data_[ 1 ]         = 1.0f / ( FieldRadius - head.x + 1 );
-        data_[ 2 ]         = 1.0f / ( FieldRadius + head.y + 1 );
-        data_[ 3 ]         = 1.0f / ( FieldRadius + head.x + 1 );
-    }
-
-    // Input (activation) for distances to food.
-    void distances_to_food_8 ( pointer data_ ) const noexcept {
-        auto const [ dir, val ] = distance_point_to_point_8 ( m_snake_body.front ( ), m_food );
-        data_[ dir ]            = val;
-    }
-
-    // Input (activation) for distances to food.
-    void distances_to_food_4 ( pointer data_ ) const noexcept {
-        auto const [ dir, val ] = distance_point_to_point_4 ( m_snake_body.front ( ), m_food );
-        data_[ dir ]            = val;
+    // Observe the environment and decide, by the cache if memoizing (not for an incremental brain, its
+    // work area needs to see every observation, the keys are of the 17 inputs), or else by the brain.
+    template<typename Brain>
+    [[nodiscard]] MoveDirection think_memoized ( Brain * const brain_, WorkArea<Brain> & work_area_,
+                                                 Cache & cache_ ) const noexcept {
+        if constexpr ( 17 == NumInput and not requires { brain_->feed_forward ( work_area_ ); } ) {
+            if ( memoize ) {
+                gather_input ( work_area_.data ( ) );
+                typename Cache::Key const key = Cache::key ( work_area_.data ( ) );
+                MoveDirection d;
+                if ( not cache_.find ( key, d ) ) {
+                    d = decide_direction ( brain_->feed_forward ( work_area_.data ( ) ) );
+                    cache_.insert ( key, d );
+                }
+                return d;
+            }
+        }
+        return decide_direction ( think ( brain_, work_area_ ) );
     }
 
-    // Input (activation) for distances to body.
-    void distances_to_body_8 ( pointer data_ ) const noexcept {
-        Point const & head = m_snake_body.front ( );
-        auto const end     = std::end ( m_snake_body );
-        auto it            = std::begin ( m_snake_body ); // This assumes the length of the snake is at least 2.
-        while ( ++it != end ) {
-            auto const [ dir, val ] = distance_point_to_point_8 ( head, *it );
-            if ( val > data_[ dir ] )
-                data_[ dir ] = val;
+    // Observe the environment and run the brain on it. An incremental brain takes the work area itself,
+    // which is told which inputs changed.
+    template<typename Brain>
+    [[nodiscard]] const_pointer think ( Brain * const brain_, WorkArea<Brain> & work_area_ ) const noexcept {
+        if constexpr ( requires { brain_->feed_forward ( work_area_ ); } ) {
+            work_area_.changed ( gather_input_changes ( work_area_.data ( ) ) );
+            return brain_->feed_forward ( work_area_ );
+        }
+        else {
+            gather_input ( work_area_.data ( ) );
+            return brain_->feed_forward ( work_area_.data ( ) );
         }
     }
 
-    // Input (activation) for distances to body.
-    void distances_to_body_4 ( pointer data_ ) const noexcept {
-        Point const & head = m_snake_body.front ( );
-        auto const end     = std::end ( m_snake_body );
-        auto it            = std::begin ( m_snake_body ); // This assumes the length of the snake is at least 2.
-        while ( ++it != end ) {
-            auto const [ dir, val ] = distance_point_to_point_4 ( head, *it );
-            if ( val > data_[ dir ] )
-                data_[ dir ] = val;
+    // Play num_episodes_ episodes in each of the Lanes snake spaces in lockstep, feed_forward_ runs
+    // the observations of all lanes of the work area. Adds the snake lengths per lane to r_.
+    template<int Lanes, typename BatchWorkArea, typename FeedForward>
+    static void play_lockstep ( SnakeSpace * const spaces_, int const num_episodes_, BatchWorkArea & work_area_,
+                                FeedForward feed_forward_, int * const r_ ) noexcept {
+        std::array<int, Lanes> episode{ };
+        std::array<bool, Lanes> playing;
+        // Move until a decision is required, returns false after the last episode of the lane.
+        auto advance = [ & ] ( int const l_ ) noexcept {
+            SnakeSpace & space = spaces_[ l_ ];
+            while ( not space.move ( ) ) {
+                r_[ l_ ] += space.m_snake_body.size ( );
+                if ( num_episodes_ == ++episode[ l_ ] )
+                    return false;
+                space.init_run ( );
+            }
+            return true;
+        };
+        int num_playing = 0;
+        for ( int l = 0; l < Lanes; ++l ) {
+            spaces_[ l ].init_run ( );
+            num_playing += ( playing[ l ] = advance ( l ) );
+        }
+        float input[ NumInput ], output[ NumOutput ];
+        while ( num_playing ) {
+            for ( int l = 0; l < Lanes; ++l ) {
+                if ( playing[ l ] ) {
+                    spaces_[ l ].gather_input ( input ); // Observe the environment.
+                    work_area_.input ( l, input );
+                }
+            }
+            feed_forward_ ( ); // Run the data of all lanes.
+            for ( int l = 0; l < Lanes; ++l ) {
+                if ( playing[ l ] ) {
+                    work_area_.output ( l, output );
+                    spaces_[ l ].m_direction = spaces_[ l ].decide_direction ( output ); // Decide where to go.
+                    if ( not( playing[ l ] = advance ( l ) ) )
+                        --num_playing;
+                }
+            }
         }
     }
 
@@ -363,9 +887,9 @@ struct SnakeSpace {
         Point const f = m_snake_body.front ( ), d = m_food - f;
         switch ( m_direction ) {
             case MoveDirection::no:
-                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<char> ( f.x - 1 ), f.y } ) );
-                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<char> ( f.y + 1 ) } ) );
-                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<char> ( f.x + 1 ), f.y } ) );
+                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<Coordinate> ( f.x - 1 ), f.y } ) );
+                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<Coordinate> ( f.y + 1 ) } ) );
+                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<Coordinate> ( f.x + 1 ), f.y } ) );
                 data_[ 3 ] = static_cast<float> ( static_cast<int> ( d.y > 0 ) * 2 - 1 ); // no
                 data_[ 4 ] = static_cast<float> ( static_cast<int> ( d.x > 0 ) * 2 - 1 ); // ea
                 data_[ 5 ] = static_cast<float> ( static_cast<int> ( d.y < 0 ) * 2 - 1 ); // so
@@ -375,9 +899,9 @@ struct SnakeSpace {
                 data_[ 9 ] = 1.0f / ( 1.0f + m_energy );
                 return;
             case MoveDirection::ea:
-                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<char> ( f.y + 1 ) } ) );
-                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<char> ( f.x + 1 ), f.y } ) );
-                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<char> ( f.y - 1 ) } ) );
+                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<Coordinate> ( f.y + 1 ) } ) );
+                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<Coordinate> ( f.x + 1 ), f.y } ) );
+                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<Coordinate> ( f.y - 1 ) } ) );
                 data_[ 3 ] = static_cast<float> ( static_cast<int> ( d.x > 0 ) * 2 - 1 ); // ea
                 data_[ 4 ] = static_cast<float> ( static_cast<int> ( d.y < 0 ) * 2 - 1 ); // so
                 data_[ 5 ] = static_cast<float> ( static_cast<int> ( d.x < 0 ) * 2 - 1 ); // we
@@ -387,9 +911,9 @@ struct SnakeSpace {
                 data_[ 9 ] = 1.0f / ( 1.0f + m_energy );
                 return;
             case MoveDirection::so:
-                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<char> ( f.x + 1 ), f.y } ) );
-                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<char> ( f.y - 1 ) } ) );
-                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<char> ( f.x - 1 ), f.y } ) );
+                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<Coordinate> ( f.x + 1 ), f.y } ) );
+                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<Coordinate> ( f.y - 1 ) } ) );
+                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<Coordinate> ( f.x - 1 ), f.y } ) );
                 data_[ 3 ] = static_cast<float> ( static_cast<int> ( d.y < 0 ) * 2 - 1 ); // so
                 data_[ 4 ] = static_cast<float> ( static_cast<int> ( d.x < 0 ) * 2 - 1 ); // we
                 data_[ 5 ] = static_cast<float> ( static_cast<int> ( d.y > 0 ) * 2 - 1 ); // no
@@ -399,9 +923,9 @@ struct SnakeSpace {
                 data_[ 9 ] = 1.0f / ( 1.0f + m_energy );
                 return;
             case MoveDirection::we:
-                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<char> ( f.y - 1 ) } ) );
-                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<char> ( f.x - 1 ), f.y } ) );
-                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<char> ( f.y + 1 ) } ) );
+                data_[ 0 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<Coordinate> ( f.y - 1 ) } ) );
+                data_[ 1 ] = static_cast<float> ( valid_empty_point ( Point{ static_cast<Coordinate> ( f.x - 1 ), f.y } ) );
+                data_[ 2 ] = static_cast<float> ( valid_empty_point ( Point{ f.x, static_cast<Coordinate> ( f.y + 1 ) } ) );
                 data_[ 3 ] = static_cast<float> ( static_cast<int> ( d.x < 0 ) * 2 - 1 ); // we
                 data_[ 4 ] = static_cast<float> ( static_cast<int> ( d.y > 0 ) * 2 - 1 ); // no
                 data_[ 5 ] = static_cast<float> ( static_cast<int> ( d.x > 0 ) * 2 - 1 ); // ea
@@ -413,72 +937,55 @@ struct SnakeSpace {
         }
     }
 
-    void encode_current_direction_2 ( pointer data_ ) const noexcept {
-        switch ( m_direction ) {
-            case MoveDirection::no:
-                data_[ 0 ] = +1.0f;
-                data_[ 1 ] = +0.0f;
-                return;
-            case MoveDirection::ea:
-                data_[ 0 ] = +0.0f;
-                data_[ 1 ] = +1.0f;
-                return;
-            case MoveDirection::so:
-                data_[ 0 ] = -1.0f;
-                data_[ 1 ] = +0.0f;
-                return;
-            case MoveDirection::we:
-                data_[ 0 ] = +0.0f;
-                data_[ 1 ] = -1.0f;
-                return;
-        }
-    }
+    // The snake as the sensors see it, a single lane (the lane argument is ignored).
+    struct View {
+        SnakeSpace const & s;
+        Point const head = s.m_snake_body.front ( );
+        [[nodiscard]] int head_x ( int ) const noexcept { return head.x; }
+        [[nodiscard]] int head_y ( int ) const noexcept { return head.y; }
+        [[nodiscard]] int food_x ( int ) const noexcept { return s.m_food.x; }
+        [[nodiscard]] int food_y ( int ) const noexcept { return s.m_food.y; }
+        [[nodiscard]] int direction ( int ) const noexcept { return static_cast<int> ( s.m_direction ); }
+        [[nodiscard]] int energy ( int ) const noexcept { return s.m_energy; }
+        [[nodiscard]] Occupancy<FieldSize> const & occupancy ( int ) const noexcept { return s.m_occupancy; }
+    };
 
-    void encode_current_direction_4 ( pointer data_ ) const noexcept { data_[ static_cast<int> ( m_direction ) ] = 1.0f; }
+    public:
+    using Sense = Sensors<FieldSize, 1>;
 
-    void encode_energy_1 ( pointer data_ ) const noexcept { data_[ 0 ] = 1.0f / ( 1.0f + m_energy ); }
+    using Encoder15 = typename Sense::Encoder15;
+    using Encoder16 = typename Sense::Encoder16;
+    using Encoder17 = typename Sense::Encoder17;
+    using Encoder27 = typename Sense::Encoder27;
 
-    public:
-    void gather_input_27 ( pointer d_ ) const noexcept { // 27
-        distances_to_wall_8 ( d_ );
-        std::memset ( d_ + 8, 0, 16 * sizeof ( float ) );
-        distances_to_food_8 ( d_ + 8 );
-        distances_to_body_8 ( d_ + 16 );
-        encode_current_direction_2 ( d_ + 24 );
-        encode_energy_1 ( d_ + 26 );
-    }
+    // The encoder of the observation, by the number of inputs of the brains.
+    using TheEncoder = typename Sense::template TheEncoder<NumInput>;
 
-    void gather_input_15 ( pointer d_ ) const noexcept { // 15
-        distances_to_wall_4 ( d_ );
-        std::memset ( d_ + 4, 0, 8 * sizeof ( float ) );
-        distances_to_food_4 ( d_ + 4 );
-        distances_to_body_4 ( d_ + 8 );
-        encode_current_direction_2 ( d_ + 12 );
-        encode_energy_1 ( d_ + 14 );
-    }
+    static_assert ( TheEncoder::Size == NumInput, "there is no encoder (list of sensors) for this number of inputs" );
 
-    void gather_input_16 ( pointer d_ ) const noexcept { // 16
-        distances_to_wall_4 ( d_ );
-        std::memset ( d_ + 4, 0, 12 * sizeof ( float ) );
-        distances_to_food_4 ( d_ + 4 );
-        distances_to_body_4 ( d_ + 8 );
-        encode_current_direction_4 ( d_ + 12 );
-    }
+    // Observe the environment, the NumInput inputs are written to d_ (the input of a work area).
+    void gather_input ( pointer d_ ) const noexcept { TheEncoder::write ( View{ *this }, d_ ); }
 
-    void gather_input_17 ( pointer d_ ) const noexcept { // 17
-        distances_to_wall_4 ( d_ );
-        std::memset ( d_ + 4, 0, 12 * sizeof ( float ) );
-        distances_to_food_4 ( d_ + 4 );
-        distances_to_body_4 ( d_ + 8 );
-        encode_current_direction_4 ( d_ + 12 );
-        encode_energy_1 ( d_ + 16 );
+    // As gather_input, but only writes the inputs that changed, returns those as a bit mask.
+    [[nodiscard]] std::uint32_t gather_input_changes ( pointer d_ ) const noexcept {
+        static_assert ( NumInput <= 32, "the changes are a 32 bit mask" );
+        float d[ NumInput ];
+        gather_input ( d );
+        std::uint32_t changes = 0;
+        for ( int i = 0; i < NumInput; ++i ) {
+            if ( d[ i ] != d_[ i ] ) {
+                d_[ i ] = d[ i ];
+                changes |= std::uint32_t{ 1 } << i;
+            }
+        }
+        return changes;
     }
 
     void print ( ) const noexcept {
         static bool _ = hide_cursor ( ); // Call only once.
         for ( int y = -FieldRadius; y <= FieldRadius; ++y ) {
             for ( int x = -FieldRadius; x <= FieldRadius; ++x ) {
-                Point const p{ static_cast<char> ( x ), static_cast<char> ( y ) };
+                Point const p{ static_cast<Coordinate> ( x ), static_cast<Coordinate> ( y ) };
                 if ( p == m_food )
                     std::wprintf ( L" \u25B2 " );
                 else if ( snake_body_contains ( p ) )
@@ -513,9 +1020,14 @@ struct SnakeSpace {
     static constexpr int EnergyTopUp = 100;
 
     int m_move_count, m_energy;
+    std::int64_t m_num_moves = 0; // All moves of all runs.
     MoveDirection m_direction;
-    std::array<Point, 384> m_snake_body_data;
+    std::vector<Point> m_snake_body_data; // BodyCapacity points.
     SnakeBody m_snake_body;
+    Occupancy<FieldSize> m_occupancy;
+    Cycles m_cycles;
+    std::uint64_t m_body_key = 0;
+    std::vector<std::uint8_t> m_links; // Per cell.
     Point m_food;
     Changes m_changes;
 };
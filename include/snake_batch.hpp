@@ -0,0 +1,234 @@
+// MIT License
+//
+// Copyright (c) 2020 degski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <vector>
+
+#include <sax/uniform_int_distribution.hpp>
+
+#include "fcc_interleaved.hpp"
+#include "rng.hpp"
+#include "snake.hpp"
+
+// Lanes snakes, each on its own field, stepped together. The state of the snakes is kept as a
+// structure of arrays, one array of Lanes values per quantity. The moves, the bounds, energy and food
+// checks, the decisions and most of the observation are straight (branch-free) loops over the lanes,
+// which vectorize. The collisions and the bodies (a ring of points and an occupancy per lane) are
+// updated per lane. The observations are written straight into the work area of a batch brain, input
+// i of lane l at [ i * Lanes + l ] (see InputBiasOutputBatch), by the sensors of SnakeSpace (see
+// Sensors). The rules are those of SnakeSpace. A lane plays its episodes one after the other. A lane
+// that's done keeps its last (valid) state and is masked out.
+template<int FieldSize, int NumInput, int NumNeurons, int NumOutput, int Lanes = NumLanes>
+struct SnakeBatch {
+
+    static_assert ( FieldSize % 2 != 0, "uneven size only" );
+
+    using Space          = SnakeSpace<FieldSize, NumInput, NumNeurons, NumOutput>;
+    using Point          = typename Space::Point;
+    using Coordinate     = typename Space::Coordinate;
+    using work_area_type = InputBiasOutputBatch<NumInput, NumNeurons, NumOutput, Lanes>;
+    using pointer        = float *;
+    using const_pointer  = float const *;
+
+    static constexpr int FieldRadius = FieldSize / 2;
+    static constexpr int NumCells    = FieldSize * FieldSize;
+    static constexpr int NumEpisodes = Space::NumEpisodes;
+    static constexpr int EnergyTopUp = Space::EnergyTopUp;
+
+    // The capacity of a body ring, a power of 2 (the index wraps by a mask), a body can fill the field.
+    static constexpr int Capacity = static_cast<int> ( std::bit_ceil ( static_cast<unsigned> ( NumCells ) ) );
+
+    using Lane = std::array<int, Lanes>;
+    using Body = std::array<Point, Capacity>;
+
+    // Write the fitness of each of the networks of the batch, lane l plays the episodes of network l.
+    template<typename BrainBatch>
+    void run ( BrainBatch const & brain_, float * const fitness_ ) noexcept {
+        static_assert ( BrainBatch::NumLanes == Lanes, "one network per lane" );
+        static thread_local work_area_type work_area;
+        int r[ Lanes ]{ };
+        play ( NumEpisodes, work_area, [ & ] ( ) noexcept { brain_.feed_forward ( work_area ); }, r );
+        for ( int l = 0; l < Lanes; ++l )
+            fitness_[ l ] = static_cast<float> ( r[ l ] ) / static_cast<float> ( NumEpisodes );
+    }
+
+    // Play num_episodes_ episodes in every lane, feed_forward_ runs the observations of all lanes of the
+    // work area. Adds the snake lengths per lane to r_.
+    template<typename FeedForward>
+    void play ( int const num_episodes_, work_area_type & work_area_, FeedForward feed_forward_, int * const r_ ) noexcept {
+        for ( int l = 0; l < Lanes; ++l ) {
+            m_episode[ l ] = 0;
+            m_playing[ l ] = 1;
+            init_lane ( l );
+        }
+        while ( step ( num_episodes_, r_ ) ) {
+            observe ( work_area_.data ( ) ); // Observe the environments,
+            feed_forward_ ( );               // run the data of all lanes,
+            decide ( work_area_.data ( ) );  // and decide where to go.
+        }
+    }
+
+    // Moves all playing lanes one step. A snake that dies adds its score to r_, its lane then starts its
+    // next episode, if it has one left. Returns whether any lane is still playing.
+    bool step ( int const num_episodes_, int * const r_ ) noexcept {
+        // All lanes at once. The head only moves if it stays in range and there's energy left.
+        for ( int l = 0; l < Lanes; ++l ) {
+            int const d = m_direction[ l ];
+            int const x = m_head_x[ l ] + ( 1 == d ) - ( 3 == d ), y = m_head_y[ l ] + ( 0 == d ) - ( 2 == d );
+            m_energy[ l ] -= m_playing[ l ];
+            m_alive[ l ]  = m_playing[ l ] & ( 0 != m_energy[ l ] ) & ( static_cast<unsigned> ( x + FieldRadius ) < FieldSize ) &
+                            ( static_cast<unsigned> ( y + FieldRadius ) < FieldSize );
+            m_head_x[ l ] = m_alive[ l ] ? x : m_head_x[ l ];
+            m_head_y[ l ] = m_alive[ l ] ? y : m_head_y[ l ];
+            m_eats[ l ]   = m_alive[ l ] & ( x == m_food_x[ l ] ) & ( y == m_food_y[ l ] );
+            m_fresh[ l ]  = 0;
+        }
+        // Per lane, the collisions and the bodies. The tail moves after the head, moving the head onto the
+        // tail is deadly.
+        int num_playing = 0;
+        for ( int l = 0; l < Lanes; ++l ) {
+            if ( not m_playing[ l ] )
+                continue;
+            ++m_num_moves;
+            Point const h = head ( l );
+            if ( m_alive[ l ] and not m_occupancy[ l ].test ( h ) ) {
+                m_occupancy[ l ].set ( h );
+                m_body[ l ][ ( m_tail[ l ] + m_length[ l ] ) & ( Capacity - 1 ) ] = h;
+                if ( m_eats[ l ] ) {
+                    ++m_length[ l ];
+                    m_energy[ l ] += EnergyTopUp;
+                    random_food ( l );
+                }
+                else {
+                    m_occupancy[ l ].reset ( m_body[ l ][ m_tail[ l ] ] );
+                    m_tail[ l ] = ( m_tail[ l ] + 1 ) & ( Capacity - 1 );
+                }
+            }
+            else {
+                r_[ l ] += m_length[ l ] + 1; // As SnakeSpace, which counts the head of the fatal move.
+                if ( num_episodes_ == ++m_episode[ l ] ) {
+                    m_playing[ l ] = 0;
+                    continue;
+                }
+                init_lane ( l );
+            }
+            ++num_playing;
+        }
+        return num_playing;
+    }
+
+    // Observe the environments, the NumInput inputs of all lanes are written to d_ (the work area).
+    void observe ( pointer d_ ) const noexcept { TheEncoder::write ( View{ *this }, d_ ); }
+
+    // The new directions from the outputs of all lanes in the work area d_. A lane that just started an
+    // episode makes its first move in its initial direction (as in SnakeSpace).
+    void decide ( const_pointer d_ ) noexcept {
+        const_pointer const o = d_ + ( work_area_type::NumInsOuts - NumOutput ) * Lanes;
+        for ( int l = 0; l < Lanes; ++l ) {
+            float const o0 = o[ l ], o1 = o[ Lanes + l ], o2 = o[ 2 * Lanes + l ];
+            int const d = m_direction[ l ];
+            int n;
+            if constexpr ( 3 == NumOutput ) { // Left, ahead, right, see SnakeSpace::decide_direction_3.
+                int const c = o0 > o1 ? ( o0 > o2 ? 0 : 2 ) : ( o1 > o2 ? 1 : 2 );
+                n           = 0 == c ? d ^ 1 : ( 1 == c ? d : 3 - d );
+            }
+            else {
+                float const o3 = o[ 3 * Lanes + l ];
+                n              = o1 > o0 ? ( o3 > o2 ? ( o3 > o1 ? 3 : 1 ) : ( o2 > o1 ? 2 : 1 ) )
+                                         : ( o3 > o2 ? ( o3 > o0 ? 3 : 0 ) : ( o2 > o0 ? 2 : 0 ) );
+            }
+            m_direction[ l ] = m_fresh[ l ] ? d : n;
+        }
+    }
+
+    [[nodiscard]] Point head ( int const l_ ) const noexcept {
+        return { static_cast<Coordinate> ( m_head_x[ l_ ] ), static_cast<Coordinate> ( m_head_y[ l_ ] ) };
+    }
+
+    private:
+    // A new episode in lane l_, as SnakeSpace::init_run.
+    void init_lane ( int const l_ ) noexcept {
+        int const d   = sax::uniform_int_distribution<int>{ 0, 3 }( Rng::gen ( ) );
+        Point const t = random_point<Point, FieldRadius - 6> ( ); // The tail.
+        Point const s = Space::Step[ d ];
+        m_occupancy[ l_ ].clear ( );
+        for ( int i = 0; i < 3; ++i ) {
+            Point const p{ static_cast<Coordinate> ( t.x + i * s.x ), static_cast<Coordinate> ( t.y + i * s.y ) };
+            m_body[ l_ ][ i ] = p;
+            m_occupancy[ l_ ].set ( p );
+        }
+        m_head_x[ l_ ]    = t.x + 2 * s.x;
+        m_head_y[ l_ ]    = t.y + 2 * s.y;
+        m_direction[ l_ ] = d;
+        m_energy[ l_ ]    = 100;
+        m_length[ l_ ]    = 3;
+        m_tail[ l_ ]      = 0;
+        m_fresh[ l_ ]     = 1;
+        random_food ( l_ );
+    }
+
+    // A uniformly drawn empty cell, if the snake fills the field the food stays where it is.
+    void random_food ( int const l_ ) noexcept {
+        if ( m_occupancy[ l_ ].num_free ( ) ) {
+            Point const f  = m_occupancy[ l_ ].random_free ( );
+            m_food_x[ l_ ] = f.x;
+            m_food_y[ l_ ] = f.y;
+        }
+    }
+
+    // The lanes as the sensors see them.
+    struct View {
+        SnakeBatch const & b;
+        [[nodiscard]] int head_x ( int const l_ ) const noexcept { return b.m_head_x[ l_ ]; }
+        [[nodiscard]] int head_y ( int const l_ ) const noexcept { return b.m_head_y[ l_ ]; }
+        [[nodiscard]] int food_x ( int const l_ ) const noexcept { return b.m_food_x[ l_ ]; }
+        [[nodiscard]] int food_y ( int const l_ ) const noexcept { return b.m_food_y[ l_ ]; }
+        [[nodiscard]] int direction ( int const l_ ) const noexcept { return b.m_direction[ l_ ]; }
+        [[nodiscard]] int energy ( int const l_ ) const noexcept { return b.m_energy[ l_ ]; }
+        [[nodiscard]] Occupancy<FieldSize> const & occupancy ( int const l_ ) const noexcept { return b.m_occupancy[ l_ ]; }
+    };
+
+    public:
+    // The sensors of SnakeSpace, over all lanes.
+    using Sense      = Sensors<FieldSize, Lanes>;
+    using TheEncoder = typename Sense::template TheEncoder<NumInput>;
+
+    static_assert ( TheEncoder::Size == NumInput, "there is no encoder (list of sensors) for this number of inputs" );
+
+    std::int64_t m_num_moves = 0; // All moves of all lanes.
+
+    // The lanes, the coordinates of the head and the food, the direction, energy and length of the snake, its
+    // tail (in its body ring), the episodes played, and as masks (0 or 1), whether the lane is playing, alive
+    // (after the bounds and energy checks of the step), eats (on the step) and fresh (a new episode).
+    alignas ( 64 ) Lane m_head_x{ }, m_head_y{ }, m_food_x{ }, m_food_y{ }, m_direction{ }, m_energy{ }, m_length{ }, m_tail{ },
+        m_episode{ }, m_playing{ }, m_alive{ }, m_eats{ }, m_fresh{ };
+    std::vector<Body> m_body = std::vector<Body> ( Lanes ); // On the heap, they grow with the field.
+    std::array<Occupancy<FieldSize>, Lanes> m_occupancy;
+};